@@ -0,0 +1,192 @@
+#ifndef ASSIGN3_ANALYSIS_CACHE_H
+#define ASSIGN3_ANALYSIS_CACHE_H
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+/// 分析结果的磁盘缓存（-cache-dir）。
+///
+/// 每个函数按自己的 IR 算一个内容哈希：逐条指令打印（不含 !dbg 之类的元数据编号，它们随整个模块变化），
+/// 再加上指令的源码行号（结果按行号输出，行号变了结果也会变）。调试 intrinsic 分析时本来就跳过，不参与哈希。
+/// 从入口函数出发，沿直接调用、取地址、全局变量的初始值找到它依赖的所有函数和全局变量，
+/// 缓存的键就是这些成员（按名字排序，没有名字的按 @0、@1 这样的编号）的名字和内容哈希合在一起的哈希。
+///
+/// 分析是从入口函数开始、对每个调用上下文重新分析被调函数的，函数的出口状态取决于调用者传进来的状态，
+/// 所以单个函数的结果没法脱离入口单独复用，缓存的粒度是入口函数及其依赖闭包：
+/// 改动和入口无关的函数（死代码、其他程序的入口）不会让缓存失效，闭包里的任何改动都会重新分析。
+class AnalysisCache {
+public:
+    explicit AnalysisCache(std::string dir) : dir(std::move(dir)) {}
+
+    /// 模块的缓存键，entry 为空或者有函数体加载失败时返回空字符串（不使用缓存）。
+    /// settings 是会改变输出的分析选项，不同的选项各自缓存
+    std::string keyFor(Module &M, Function *entry, const std::string &settings = "") {
+        if (!entry) return "";
+        ModuleSlotTracker MST(&M);
+
+        std::map<std::string, uint64_t> members;
+        std::set<const GlobalValue *> visited;
+        std::vector<const GlobalValue *> worklist;
+        visited.insert(entry);
+        worklist.push_back(entry);
+        while (!worklist.empty()) {
+            const GlobalValue *gv = worklist.back();
+            worklist.pop_back();
+
+            std::vector<const Value *> uses;
+            uint64_t hash;
+            if (const Function *fn = dyn_cast<Function>(gv)) {
+                if (fn->isMaterializable()) {
+                    if (Error err = const_cast<Function *>(fn)->materialize()) {
+                        consumeError(std::move(err));
+                        return "";
+                    }
+                }
+                hash = hashFunction(*fn, MST, uses);
+            } else {
+                hash = hashGlobal(*gv, MST, uses);
+            }
+            members[memberName(*gv, MST)] = hash;
+
+            // 常量表达式和常量聚合里也可能引用函数（函数指针数组、强转过的函数地址）
+            while (!uses.empty()) {
+                const Value *val = uses.back();
+                uses.pop_back();
+                if (const GlobalValue *dep = dyn_cast<GlobalValue>(val)) {
+                    if (visited.insert(dep).second) worklist.push_back(dep);
+                } else if (const Constant *c = dyn_cast<Constant>(val)) {
+                    for (const Use &op : c->operands()) uses.push_back(op.get());
+                }
+            }
+        }
+
+        std::string text = formatVersion;
+        if (!settings.empty()) text += "\n" + settings;
+        for (const auto &member : members) {
+            text += "\n" + member.first + " " + utohexstr(member.second);
+        }
+        return utohexstr(xxHash64(text));
+    }
+
+    /// 命中时把缓存的输出放进 output
+    bool lookup(const std::string &key, std::string &output) {
+        if (key.empty()) return false;
+        ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(pathFor(key));
+        if (!buffer) return false;
+        StringRef content = (*buffer)->getBuffer();
+        std::string prefix = header(key);
+        if (!content.startswith(prefix)) return false;
+        output = content.drop_front(prefix.size()).str();
+        return true;
+    }
+
+    /// 先写临时文件再 rename，批处理时多个线程同时写同一个键也不会读到写了一半的文件
+    void store(const std::string &key, const std::string &output) {
+        if (key.empty()) return;
+        if (sys::fs::create_directories(dir)) return;
+        SmallString<128> tmpPath;
+        int fd;
+        if (sys::fs::createUniqueFile(pathFor(key) + ".tmp-%%%%%%", fd, tmpPath)) return;
+        {
+            raw_fd_ostream out(fd, /*shouldClose=*/true);
+            out << header(key) << output;
+        }
+        if (sys::fs::rename(tmpPath, pathFor(key))) {
+            sys::fs::remove(tmpPath);
+        }
+    }
+
+private:
+    /// 输出格式或者分析的行为变了就改这个版本号，旧缓存自动作废
+    static constexpr const char *formatVersion = "funcptr-cache v2";
+
+    std::string dir;
+
+    std::string pathFor(const std::string &key) const {
+        SmallString<128> path(dir);
+        sys::path::append(path, key + ".txt");
+        return path.str().str();
+    }
+
+    static std::string header(const std::string &key) {
+        return std::string(formatVersion) + " " + key + "\n";
+    }
+
+    /// 成员在键里的名字：有名字的是 @名字，没有名字的是模块里的编号 @0、@1，不会互相撞上
+    static std::string memberName(const GlobalValue &gv, ModuleSlotTracker &MST) {
+        std::string name;
+        raw_string_ostream os(name);
+        gv.printAsOperand(os, false, MST);
+        return os.str();
+    }
+
+    /// 打印出来的一条 IR 去掉末尾的 count 个元数据附件（", !dbg !12" 之类）。
+    /// 附件总是打印在最后，每个都是 ", !名字 !编号"，所以从后往前去掉 count 个；
+    /// 字符串常量、初始值里出现的 ", !" 在附件前面，不会被去掉
+    static StringRef stripAttachments(StringRef text, size_t count) {
+        for (; count > 0; count--) {
+            size_t pos = text.rfind(", !");
+            if (pos == StringRef::npos) break;
+            text = text.substr(0, pos);
+        }
+        return text;
+    }
+
+    static uint64_t hashFunction(const Function &fn, ModuleSlotTracker &MST,
+                                 std::vector<const Value *> &uses) {
+        std::string text;
+        raw_string_ostream os(text);
+        os << *fn.getFunctionType() << " " << fn.getName() << " " << fn.getLinkage() << "\n";
+        for (const BasicBlock &bb : fn) {
+            os << "bb\n";
+            for (const Instruction &inst : bb) {
+                if (isa<DbgInfoIntrinsic>(&inst)) continue;
+                std::string line;
+                raw_string_ostream ls(line);
+                inst.print(ls, MST);
+                SmallVector<std::pair<unsigned, MDNode *>, 4> attachments;
+                inst.getAllMetadata(attachments);
+                os << stripAttachments(ls.str(), attachments.size());
+                if (const DebugLoc &loc = inst.getDebugLoc()) os << " @" << loc.getLine();
+                os << "\n";
+                for (const Use &op : inst.operands()) {
+                    if (isa<Constant>(op.get())) uses.push_back(op.get());
+                }
+            }
+        }
+        return xxHash64(os.str());
+    }
+
+    static uint64_t hashGlobal(const GlobalValue &gv, ModuleSlotTracker &MST,
+                               std::vector<const Value *> &uses) {
+        std::string text;
+        raw_string_ostream os(text);
+        gv.print(os, MST);
+        SmallVector<std::pair<unsigned, MDNode *>, 4> attachments;
+        if (const GlobalVariable *var = dyn_cast<GlobalVariable>(&gv)) {
+            if (var->hasInitializer()) uses.push_back(var->getInitializer());
+            var->getAllMetadata(attachments);
+        } else if (const GlobalAlias *alias = dyn_cast<GlobalAlias>(&gv)) {
+            uses.push_back(alias->getAliasee());
+        }
+        return xxHash64(stripAttachments(StringRef(os.str()).rtrim(), attachments.size()));
+    }
+};
+
+#endif //ASSIGN3_ANALYSIS_CACHE_H
@@ -0,0 +1,80 @@
+#ifndef ASSIGN3_BUDGET_H
+#define ASSIGN3_BUDGET_H
+
+#include "llvm/Support/Process.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+using namespace llvm;
+
+/// 分析的资源预算（-time-budget、-memory-budget、-iteration-budget、-call-depth-budget），0 表示不限制
+struct AnalysisBudget {
+    uint64_t timeMs = 0;       // 从开始求解算起的墙钟时间
+    uint64_t memoryMB = 0;     // malloc 已分配的内存，整个进程一起算（批处理时包括其他工作线程）
+    uint64_t blockVisits = 0;  // 基本块被求值的总次数，包括递归分析被调函数时的访问
+    uint64_t callDepth = 0;    // 入口函数下面最多递归分析几层被调函数，只影响更深的调用，不会用完
+
+    bool any() const { return timeMs || memoryMB || blockVisits || callDepth; }
+};
+
+/// 求解过程中检查预算是否用完。用完以后一直保持用完的状态，正在进行的求解都会停下来，
+/// 见 PointToVisitor::degradeFunction。
+/// 访问次数每次都检查，时间和内存的开销大一些，每 CheckInterval 次检查一次，
+/// 或者调用方要求立刻检查（每次进入调用时，见 PointToVisitor::handleCallInst）。
+class BudgetMonitor {
+public:
+    static constexpr unsigned CheckInterval = 64;
+
+    void start(const AnalysisBudget &limits, uint64_t blockVisits) {
+        budget = limits;
+        startVisits = blockVisits;
+        startTime = std::chrono::steady_clock::now();
+        checks = 0;
+        reason.clear();
+    }
+
+    bool enabled() const { return budget.any(); }
+
+    /// blockVisits 是到目前为止的总访问次数，sampleNow 为 true 时不等 CheckInterval，立刻检查时间和内存
+    bool exhausted(uint64_t blockVisits, bool sampleNow = false) {
+        if (!reason.empty()) return true;
+        if (!budget.any()) return false;
+        if (budget.blockVisits && blockVisits - startVisits >= budget.blockVisits) {
+            reason = "iteration budget of " + std::to_string(budget.blockVisits) + " block visits";
+            return true;
+        }
+        if (checks++ % CheckInterval != 0 && !sampleNow) return false;
+        if (budget.timeMs) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - startTime).count();
+            if ((uint64_t)elapsed >= budget.timeMs) {
+                reason = "time budget of " + std::to_string(budget.timeMs) + " ms";
+                return true;
+            }
+        }
+        if (budget.memoryMB && sys::Process::GetMallocUsage() >= budget.memoryMB * 1024 * 1024) {
+            reason = "memory budget of " + std::to_string(budget.memoryMB) + " MB";
+            return true;
+        }
+        return false;
+    }
+
+    /// 被调函数在求解栈上的深度（入口函数的被调函数是 1）超过调用深度预算
+    bool tooDeep(size_t depth) const {
+        return budget.callDepth && depth > budget.callDepth;
+    }
+
+    uint64_t callDepth() const { return budget.callDepth; }
+
+    /// 用完时是哪一项，没用完时为空
+    const std::string &getReason() const { return reason; }
+
+private:
+    AnalysisBudget budget;
+    uint64_t startVisits = 0;
+    std::chrono::steady_clock::time_point startTime;
+    unsigned checks = 0;
+    std::string reason;
+};
+
+#endif //ASSIGN3_BUDGET_H
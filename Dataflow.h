@@ -10,10 +10,17 @@
 #define _DATAFLOW_H_
 
 #include <llvm/Support/raw_ostream.h>
+#include <cassert>
+#include <cstdint>
 #include <map>
+#include <set>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/CFG.h>
 #include <llvm/IR/Function.h>
+#include "MemoryUsage.h"
+#include "PerfCounters.h"
+#include "Stats.h"
+#include "Trace.h"
 
 //#define GDEBUG
 
@@ -28,8 +35,27 @@
   } while (0)
 #endif
 
+// 打开后每次比较数据流值都会同时做完整比较，并检查增量维护的指纹是否和重新计算的一致
+//#define CHECK_FINGERPRINT
+
 using namespace llvm;
 
+///
+/// 数据流值的增量指纹：状态里的每个成员（比如 (key, value) 对）对应一个 64 位哈希，
+/// 指纹是所有成员哈希的异或。插入和删除都只需要异或一次，集合相同时指纹一定相同，
+/// 指纹不同时可以直接判定不相等，只有指纹相同时才需要做完整比较。
+///
+/// @tag 区分同一个状态里不同的容器
+inline uint64_t fingerprintOf(unsigned tag, const void *key, const void *val = nullptr) {
+    uint64_t x = reinterpret_cast<uintptr_t>(key) * 0x9E3779B97F4A7C15ULL
+               ^ reinterpret_cast<uintptr_t>(val) * 0xC2B2AE3D27D4EB4FULL
+               ^ (static_cast<uint64_t>(tag) + 1) * 0x165667B19E3779F9ULL;
+    // splitmix64 finalizer
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
 ///Base dataflow visitor class, defines the dataflow function
 
 template <class T>
@@ -37,6 +63,16 @@ class DataflowVisitor {
 public:
     virtual ~DataflowVisitor() { }
 
+    /// 不为空时记录每个函数求解和访问基本块的次数，见 AnalysisStats
+    AnalysisStats *stats = nullptr;
+    /// 不为空时把每次求解和 worklist 的每次迭代记到时间线上，见 TraceRecorder
+    TraceRecorder *trace = nullptr;
+    /// 不为空时把每次前向求解自身（不含递归分析的被调函数）的硬件计数器记到函数上，见 PerfProfile
+    PerfProfile *perf = nullptr;
+
+    /// 资源预算用完时返回 true，compForwardDataflow 在每次迭代前检查，用完就放弃这次求解
+    virtual bool budgetExhausted() { return false; }
+
     /// Dataflow Function invoked for each basic block 
     /// 
     /// @block the Basic Block
@@ -73,6 +109,44 @@ public:
     virtual void merge( T *dest, const T &src ) = 0;
 };
 
+///
+/// 按基本块在函数里的先后顺序出队的 worklist。
+/// 不能直接用 std::set<BasicBlock *>：那样出队顺序取决于基本块的内存地址，
+/// 同一个进程里先后分析多个模块时地址会复用，结果就不稳定了。
+///
+class BlockWorklist {
+public:
+    explicit BlockWorklist(Function *fn) {
+        unsigned index = 0;
+        for (BasicBlock &bb : *fn) {
+            order[&bb] = index++;
+        }
+    }
+
+    void insert(BasicBlock *bb) {
+        pending.insert(std::make_pair(order[bb], bb));
+    }
+
+    bool empty() const {
+        return pending.empty();
+    }
+
+    /// 基本块在函数里的序号
+    unsigned indexOf(BasicBlock *bb) {
+        return order[bb];
+    }
+
+    BasicBlock *pop() {
+        BasicBlock *bb = pending.begin()->second;
+        pending.erase(pending.begin());
+        return bb;
+    }
+
+private:
+    std::map<BasicBlock *, unsigned> order;
+    std::set<std::pair<unsigned, BasicBlock *> > pending;
+};
+
 ///
 /// Dummy class to provide a typedef for the detailed result set
 /// For each basicblock, we compute its input dataflow val and its output dataflow val
@@ -91,14 +165,21 @@ struct DataflowResult {
 /// @param visitor A function to compute dataflow vals
 /// @param result The results of the dataflow
 /// @initval the Initial dataflow value
+/// @return false if the visitor's budget ran out and result is not a fixedpoint
 /// 根据已有的compBackwardDataflow补充Forward的实现
 template<class T>
-void compForwardDataflow(Function *fn,
+bool compForwardDataflow(Function *fn,
                          DataflowVisitor<T> *visitor,
                          typename DataflowResult<T>::Type *result, //std::map<BasicBlock *, std::pair<T, T> > Type;
                          const T & initval) {
 
-    std::set<BasicBlock *> worklist;
+    BlockWorklist worklist(fn);
+    AnalysisStats::FunctionStats *fnStats = visitor->stats ? &visitor->stats->functions[fn] : nullptr;
+    if (fnStats) fnStats->forwardSolves++;
+    TraceScope solveSpan(visitor->trace, "solve", fn->getName());
+    PerfProfile::Scope perfScope(visitor->perf, visitor->perf ? visitor->perf->function(fn) : nullptr,
+                                 PerfProfile::FunctionLevel);
+    uint64_t visits = 0;
 
     // Initialize the worklist with all entry blocks
     for (Function::iterator bi = fn->begin(); bi != fn->end(); ++bi) {
@@ -114,8 +195,14 @@ void compForwardDataflow(Function *fn,
 
     // Iteratively compute the dataflow result
     while (!worklist.empty()) {
-        BasicBlock *bb = *worklist.begin();
-        worklist.erase(worklist.begin());
+        if (visitor->budgetExhausted()) {
+            solveSpan.arg("aborted", true);
+            return false;
+        }
+        BasicBlock *bb = worklist.pop();
+        if (fnStats) fnStats->forwardVisits++;
+        visits++;
+        TraceScope blockSpan(visitor->trace, "block", fn->getName());
 
         // Merge all incoming value
         T bbentryval = (*result)[bb].first;
@@ -131,6 +218,10 @@ void compForwardDataflow(Function *fn,
         LOG_DEBUG("Start Handling Basic block " << bb->getName());
         visitor->compDFVal(bb, &bbentryval, true);
         (*result)[bb].second = bbentryval;
+        if (blockSpan.enabled()) {
+            blockSpan.arg("block", (int64_t)worklist.indexOf(bb));
+            blockSpan.arg("state", (int64_t)bbentryval.entryCount());
+        }
 
         LOG_DEBUG("Basic block " << bb->getName() << " in function " << bb->getParent()->getName() << " finished. ");
         LOG_DEBUG("Incoming values: \n" << (*result)[bb].first);
@@ -146,6 +237,11 @@ void compForwardDataflow(Function *fn,
         }
 
     }
+    solveSpan.arg("blocks", (int64_t)fn->size());
+    solveSpan.arg("visits", (int64_t)visits);
+    if (fnStats) fnStats->peakResultBytes = std::max(fnStats->peakResultBytes, heapBytes(*result));
+    // 被调函数的求解中途放弃时，这里的结果也是不完整的
+    return !visitor->budgetExhausted();
 }
 
 /// 
@@ -163,7 +259,9 @@ void compBackwardDataflow(Function *fn,
     typename DataflowResult<T>::Type *result,
     const T &initval) {
 
-    std::set<BasicBlock *> worklist;
+    BlockWorklist worklist(fn);
+    AnalysisStats::FunctionStats *fnStats = visitor->stats ? &visitor->stats->functions[fn] : nullptr;
+    if (fnStats) fnStats->backwardSolves++;
 
     // Initialize the worklist with all exit blocks
     for (Function::iterator bi = fn->begin(); bi != fn->end(); ++bi) {
@@ -175,8 +273,8 @@ void compBackwardDataflow(Function *fn,
 
     // Iteratively compute the dataflow result
     while (!worklist.empty()) {
-        BasicBlock *bb = *worklist.begin();
-        worklist.erase(worklist.begin());
+        BasicBlock *bb = worklist.pop();
+        if (fnStats) fnStats->backwardVisits++;
 
         // Merge all incoming value
         T bbexitval = (*result)[bb].second;
@@ -200,6 +298,7 @@ void compBackwardDataflow(Function *fn,
             worklist.insert(*pi);
         }
     }
+    if (fnStats) fnStats->peakResultBytes = std::max(fnStats->peakResultBytes, heapBytes(*result));
     LOG_DEBUG("end of compBackwardDataflow\n");
 }
 
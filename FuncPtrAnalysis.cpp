@@ -0,0 +1,160 @@
+#include "FuncPtrAnalysis.h"
+#include "Relevance.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+void FuncPtrAnalysis::run(Module &M) {
+    run(M, Options());
+}
+
+void FuncPtrAnalysis::run(Module &M, const Options &options) {
+    DataflowResult<PointToInfo>::Type result;
+    PointToInfo initval;
+
+    visitor.keepStates = options.keepStates;
+    visitor.typeFilter = options.typeFilter;
+    visitor.maxPointsTo = options.maxPointsTo;
+    // 切片需要一次看到整个模块，懒加载时函数体是逐个出现的，所以不用切片
+    visitor.materialize = options.materialize;
+    visitor.livenessProvider = options.liveness;
+    visitor.stats = options.stats;
+    visitor.trace = options.trace;
+    visitor.perf = options.perf;
+    visitor.budget.start(options.budget, visitor.blockVisits);
+    std::unique_ptr<RelevanceSlice> slice;
+    if (options.slice && !options.materialize) {
+        slice.reset(new RelevanceSlice(M));
+        visitor.slice = slice.get();
+    }
+
+    entry = findEntryFunction(M);
+    if (!entry) {
+        return;
+    }
+    visitor.ensureMaterialized(entry);
+
+    LOG_DEBUG("Entry function: " << entry->getName());
+    visitor.beginSolve(entry, &result);
+    if (!compForwardDataflow(entry, &visitor, &result, initval)) {
+        visitor.degradeFunction(entry);
+    }
+    visitor.endSolve(entry);
+    visitor.recordStates(entry, result);
+    visitor.recordMemory();
+
+    // slice、materialize、liveness、stats、trace 和 perf 引用的对象在这之后就失效了，之后查询时重放指令不再过滤
+    visitor.slice = nullptr;
+    visitor.stats = nullptr;
+    visitor.trace = nullptr;
+    visitor.perf = nullptr;
+    visitor.materialize = nullptr;
+    visitor.livenessProvider = nullptr;
+}
+
+Function *FuncPtrAnalysis::findEntryFunction(Module &M) {
+    //  找到这个Module里面的最后一个定义的函数（在c文件里的最后一个）
+    auto f = M.rbegin(), e = M.rend();
+    while (f != e && (f->isIntrinsic() || f->isDeclaration())) {
+        f++;
+    }
+    return f == e ? nullptr : &*f;
+}
+
+std::vector<const Function *> FuncPtrAnalysis::getCallees(const CallBase *call) const {
+    std::vector<const Function *> callees;
+    const CallInst *callInst = dyn_cast<CallInst>(call);
+    if (!callInst) {
+        return callees;
+    }
+    auto it = visitor.callSiteTargets.find(const_cast<CallInst *>(callInst));
+    if (it != visitor.callSiteTargets.end()) {
+        callees.assign(it->second.begin(), it->second.end());
+    }
+    std::sort(callees.begin(), callees.end(), [](const Function *a, const Function *b) {
+        return a->getName() < b->getName();
+    });
+    return callees;
+}
+
+bool FuncPtrAnalysis::isApproximated(const CallBase *call) const {
+    const CallInst *callInst = dyn_cast<CallInst>(call);
+    return callInst && visitor.approximatedCalls.count(const_cast<CallInst *>(callInst));
+}
+
+bool FuncPtrAnalysis::stateAt(const Value *val, const Instruction *at, PointToInfo &scratch) {
+    const Function *fn = nullptr;
+    if (at) {
+        fn = at->getFunction();
+    } else if (const Instruction *inst = dyn_cast<Instruction>(val)) {
+        fn = inst->getFunction();
+    } else if (const Argument *arg = dyn_cast<Argument>(val)) {
+        fn = arg->getParent();
+    }
+    if (!fn || fn->empty()) {
+        return false;
+    }
+
+    auto states = visitor.functionStates.find(const_cast<Function *>(fn));
+    if (states == visitor.functionStates.end()) {
+        return false;
+    }
+    if (!at) {
+        auto exit = states->second.find(const_cast<BasicBlock *>(&fn->back()));
+        if (exit == states->second.end()) return false;
+        scratch = exit->second.second;
+        return true;
+    }
+
+    // 从所在基本块的入口状态开始，重放到 at 之前。
+    // 重放到调用时会重新分析被调函数，用一个临时的 visitor，查询不会往 results、callSiteTargets 里添东西
+    BasicBlock *bb = const_cast<BasicBlock *>(at->getParent());
+    auto block = states->second.find(bb);
+    if (block == states->second.end()) return false;
+    scratch = block->second.first;
+    PointToVisitor replay;
+    replay.typeFilter = visitor.typeFilter;
+    replay.maxPointsTo = visitor.maxPointsTo;
+    for (Instruction &inst : *bb) {
+        if (&inst == at) break;
+        replay.compDFVal(&inst, &scratch);
+    }
+    return true;
+}
+
+std::set<const Value *> FuncPtrAnalysis::getPointsTo(const Value *val, const Instruction *at) {
+    std::set<const Value *> pointsTo;
+    PointToInfo state;
+    if (!stateAt(val, at, state)) {
+        return pointsTo;
+    }
+    for (Value *target : state.getBindingOrSelf(const_cast<Value *>(val))) {
+        insertExpanded(state.getPointToSet(target), pointsTo);
+    }
+    return pointsTo;
+}
+
+std::set<const Value *> FuncPtrAnalysis::getAliases(const Value *val, const Instruction *at) {
+    std::set<const Value *> aliases;
+    PointToInfo state;
+    if (!stateAt(val, at, state)) {
+        return aliases;
+    }
+    insertExpanded(state.getBindingOrSelf(const_cast<Value *>(val)), aliases);
+    return aliases;
+}
+
+void FuncPtrAnalysis::insertExpanded(const std::set<Value *> &values, std::set<const Value *> &out) const {
+    for (Value *val : values) {
+        if (!PointToInfo::isTop(val)) {
+            out.insert(val);
+            continue;
+        }
+        for (const Function &fn : *entry->getParent()) {
+            if (!fn.isIntrinsic() && fn.hasAddressTaken()) {
+                out.insert(&fn);
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef ASSIGN3_FUNC_PTR_ANALYSIS_H
+#define ASSIGN3_FUNC_PTR_ANALYSIS_H
+
+#include "PointTo.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include <functional>
+#include <memory>
+#include <vector>
+using namespace llvm;
+
+/// 函数指针分析的程序化接口（funcptr 库），其他工具可以直接链接后在进程内查询，
+/// 不用再去解析 printResults 输出的 "行号 : 函数名" 文本。
+///
+/// 用法：
+///     FuncPtrAnalysis analysis;
+///     analysis.run(M);                      // M 需要已经做过 mem2reg
+///     analysis.getCallees(call);
+///     analysis.getPointsTo(ptr, inst);
+class FuncPtrAnalysis {
+public:
+    struct Options {
+        bool slice = true;       // 用 RelevanceSlice 跳过和函数指针无关的指令
+        bool keepStates = true;  // 保留每个函数的状态，getCallees / getPointsTo 依赖它
+        bool typeFilter = true;  // 间接调用跳过类型对不上的候选函数，见 PointToVisitor::handleCallInst
+        // 懒加载模块时加载函数体的回调，见 PointToVisitor::materialize
+        std::function<void(Function *)> materialize;
+        // 活跃变量结果的来源，见 PointToVisitor::livenessProvider
+        std::function<const DataflowResult<LivenessInfo>::Type &(Function *)> liveness;
+        // 不为空时把统计记到这里（-stats），见 AnalysisStats
+        AnalysisStats *stats = nullptr;
+        // 不为空时把求解过程记到时间线上（-trace），见 TraceRecorder
+        TraceRecorder *trace = nullptr;
+        // 不为空时把每个函数自身的硬件计数器记到这里（-perf-counters），见 PerfProfile
+        PerfProfile *perf = nullptr;
+        // 资源预算，用完时剩下的部分按函数类型给出保守结果，见 PointToVisitor::degradeFunction
+        AnalysisBudget budget;
+        // 集合里的函数超过这么多个时折叠成 top，0 表示不限制，见 PointToInfo::top
+        unsigned maxPointsTo = 64;
+    };
+
+    /// 从 findEntryFunction 找到的入口函数开始求解
+    void run(Module &M);
+    void run(Module &M, const Options &options);
+
+    /// 模块里最后一个定义的函数（C 文件里的最后一个函数），没有定义任何函数时为空
+    static Function *findEntryFunction(Module &M);
+
+    /// 分析的入口函数，run 之前为空
+    Function *getEntryFunction() const { return entry; }
+
+    /// 调用点可能调用的函数，按函数名排序；没有被分析走到的调用点返回空
+    std::vector<const Function *> getCallees(const CallBase *call) const;
+
+    /// 调用点的目标里有没有按类型补上的函数（折叠成 top 后展开、预算用完后退化），
+    /// 这样的目标集合只是类型相符的函数，不是分析出来的结果
+    bool isApproximated(const CallBase *call) const;
+
+    /// 在 at 执行之前，val 指向的内存里可能存放的值；at 为空时取 val 所在函数出口处的状态。
+    /// 没有被分析走到的位置返回空集合。折叠成 top 的部分展开成模块里所有取过地址的函数。
+    std::set<const Value *> getPointsTo(const Value *val, const Instruction *at = nullptr);
+
+    /// 在 at 执行之前，val 等同于哪些内存对象或函数（binding），没有 binding 时就是它自身，top 的展开同上
+    std::set<const Value *> getAliases(const Value *val, const Instruction *at = nullptr);
+
+    /// 行号 -> 被调函数名，和命令行输出的内容一致
+    const std::map<unsigned, std::set<std::string>> &getLineResults() const { return visitor.results; }
+
+    /// 结果是预算用完后按类型退化得到的行号，没有设预算或预算够用时为空
+    const std::set<unsigned> &getDegradedLines() const { return visitor.degradedLines; }
+
+    void printResults(raw_ostream &out) { visitor.printResults(out); }
+
+    PointToVisitor &getVisitor() { return visitor; }
+
+private:
+    PointToVisitor visitor;
+    Function *entry = nullptr;
+
+    /// 计算 at 之前（或 fn 出口处）的状态，结果放在 scratch 里
+    bool stateAt(const Value *val, const Instruction *at, PointToInfo &scratch);
+
+    /// 把 values 并入 out，top 换成模块里所有取过地址的函数
+    void insertExpanded(const std::set<Value *> &values, std::set<const Value *> &out) const;
+};
+
+#endif //ASSIGN3_FUNC_PTR_ANALYSIS_H
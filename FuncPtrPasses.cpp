@@ -0,0 +1,155 @@
+#include "FuncPtrPasses.h"
+
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/Utils/CallPromotionUtils.h"
+
+using namespace llvm;
+
+AnalysisKey LivenessAnalysis::Key;
+AnalysisKey FuncPtrModuleAnalysis::Key;
+
+LivenessAnalysis::Result LivenessAnalysis::run(Function &F, FunctionAnalysisManager &) {
+    LivenessVisitor visitor;
+    Result result;
+    LivenessInfo initval;
+    compBackwardDataflow(&F, &visitor, &result, initval);
+    return result;
+}
+
+FuncPtrModuleAnalysis::Result FuncPtrModuleAnalysis::run(Module &M, ModuleAnalysisManager &MAM) {
+    FunctionAnalysisManager &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+    FuncPtrAnalysis analysis;
+    FuncPtrAnalysis::Options options;
+    options.liveness = [&FAM](Function *F) -> const DataflowResult<LivenessInfo>::Type & {
+        return FAM.getResult<LivenessAnalysis>(*F);
+    };
+    analysis.run(M, options);
+    return analysis;
+}
+
+PreservedAnalyses FuncPtrPrinterPass::run(Module &M, ModuleAnalysisManager &MAM) {
+    MAM.getResult<FuncPtrModuleAnalysis>(M).printResults(out);
+    return PreservedAnalyses::all();
+}
+
+PreservedAnalyses LivenessPrinterPass::run(Function &F, FunctionAnalysisManager &FAM) {
+    out << "Liveness of " << F.getName() << ":\n";
+    const auto &result = FAM.getResult<LivenessAnalysis>(F);
+    // 按基本块在函数里的顺序打印，不按指针顺序
+    for (BasicBlock &bb : F) {
+        auto it = result.find(&bb);
+        if (it == result.end()) continue;
+        out << bb.getName() << "\n\tin : " << it->second.first
+            << "\n\tout :  " << it->second.second << "\n";
+    }
+    return PreservedAnalyses::all();
+}
+
+/// 分析不处理全局变量的初始值（比如 int (*g)(int, int) = plus;），
+/// 只要有函数的地址出现在某个初始值里，就不能认为分析出的目标集合是完整的
+static bool hasFunctionInGlobalInitializer(Module &M) {
+    for (GlobalVariable &GV : M.globals()) {
+        if (!GV.hasInitializer()) continue;
+        std::vector<const Constant *> pending = {GV.getInitializer()};
+        while (!pending.empty()) {
+            const Constant *c = pending.back();
+            pending.pop_back();
+            if (isa<Function>(c)) return true;
+            // 其他全局变量的地址：它们自己的初始值在外层循环里检查
+            if (isa<GlobalValue>(c)) continue;
+            for (const Use &op : c->operands()) {
+                if (const Constant *sub = dyn_cast<Constant>(op.get())) pending.push_back(sub);
+            }
+        }
+    }
+    return false;
+}
+
+PreservedAnalyses FuncPtrPromotionPass::run(Module &M, ModuleAnalysisManager &MAM) {
+    FuncPtrAnalysis &analysis = MAM.getResult<FuncPtrModuleAnalysis>(M);
+
+    // 先把要改的调用点和目标都收集下来，改写会新建基本块，边遍历边改不安全
+    std::vector<std::pair<CallInst *, std::vector<Function *>>> sites;
+    for (Function &F : M) {
+        for (BasicBlock &BB : F) {
+            for (Instruction &I : BB) {
+                CallInst *call = dyn_cast<CallInst>(&I);
+                if (!call || call->getCalledFunction() || call->isInlineAsm()) continue;
+                std::vector<Function *> targets;
+                for (const Function *callee : analysis.getCallees(call)) {
+                    // malloc 之类的外部函数也会出现在结果里，它们同样可以直接调用
+                    targets.push_back(const_cast<Function *>(callee));
+                }
+                if (!targets.empty()) sites.emplace_back(call, std::move(targets));
+            }
+        }
+    }
+    if (sites.empty()) {
+        return PreservedAnalyses::all();
+    }
+
+    // 有函数地址出现在全局变量初始值里时，分析看不到这些初始值，所有目标集合都可能缺函数
+    bool initializersModeled = !hasFunctionInGlobalInitializer(M);
+    for (auto &site : sites) {
+        CallInst *call = site.first;
+        std::vector<Function *> &targets = site.second;
+
+        bool complete = initializersModeled && !analysis.isApproximated(call);
+        if (complete) {
+            MDBuilder builder(M.getContext());
+            call->setMetadata(LLVMContext::MD_callees, builder.createCallees(targets));
+            numAnnotated++;
+        }
+
+        if (targets.size() > maxTargets) continue;
+        bool legal = true;
+        for (Function *target : targets) {
+            legal = legal && isLegalToPromote(*call, target);
+        }
+        if (!legal) continue;
+
+        // promoteCallWithIfThenElse 把 call 留在 else 分支里，接着对它提升下一个目标。
+        // 集合完整时走到最后的 else 只可能是最后一个目标，直接调用它；
+        // 不完整时最后一个目标也要比较，else 里保留原来的间接调用，程序行为不变
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (complete && i + 1 == targets.size()) {
+                promoteCall(*call, targets[i]);
+            } else {
+                promoteCallWithIfThenElse(*call, targets[i]);
+            }
+        }
+        numPromoted++;
+    }
+    return PreservedAnalyses::none();
+}
+
+void registerFuncPtrPasses(PassBuilder &PB) {
+    PB.registerAnalysisRegistrationCallback([](ModuleAnalysisManager &MAM) {
+        MAM.registerPass([] { return FuncPtrModuleAnalysis(); });
+    });
+    PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &FAM) {
+        FAM.registerPass([] { return LivenessAnalysis(); });
+    });
+    PB.registerPipelineParsingCallback(
+        [](StringRef name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+            if (name == "print-funcptr") {
+                MPM.addPass(FuncPtrPrinterPass(errs()));
+                return true;
+            }
+            if (name == "promote-funcptr") {
+                MPM.addPass(FuncPtrPromotionPass());
+                return true;
+            }
+            return false;
+        });
+    PB.registerPipelineParsingCallback(
+        [](StringRef name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+            if (name == "print-liveness") {
+                FPM.addPass(LivenessPrinterPass(errs()));
+                return true;
+            }
+            return false;
+        });
+}
@@ -0,0 +1,87 @@
+#ifndef ASSIGN3_FUNC_PTR_PASSES_H
+#define ASSIGN3_FUNC_PTR_PASSES_H
+
+#include "FuncPtrAnalysis.h"
+#include "Liveness.h"
+#include "llvm/IR/PassManager.h"
+using namespace llvm;
+
+/// 新 PassManager 版本的分析和打印 pass。结果由 AnalysisManager 缓存，
+/// 没有被后续 pass 声明保留（PreservedAnalyses）时自动失效。
+/// 既可以通过 FuncPtrPlugin.so 在 opt 里用 -load-pass-plugin 加载，
+/// 也可以链接 funcptr 库后在自己的 PassBuilder 上调用 registerFuncPtrPasses 注册。
+///
+///     opt -load-pass-plugin ./FuncPtrPlugin.so -passes='mem2reg,print-funcptr' -disable-output x.bc
+
+/// 单个函数的活跃变量（Liveness.h 里的后向数据流）
+class LivenessAnalysis : public AnalysisInfoMixin<LivenessAnalysis> {
+public:
+    using Result = DataflowResult<LivenessInfo>::Type;
+    Result run(Function &F, FunctionAnalysisManager &FAM);
+
+private:
+    friend AnalysisInfoMixin<LivenessAnalysis>;
+    static AnalysisKey Key;
+};
+
+/// 整个模块的函数指针分析，活跃变量结果从 FunctionAnalysisManager 里取缓存
+class FuncPtrModuleAnalysis : public AnalysisInfoMixin<FuncPtrModuleAnalysis> {
+public:
+    using Result = FuncPtrAnalysis;
+    Result run(Module &M, ModuleAnalysisManager &MAM);
+
+private:
+    friend AnalysisInfoMixin<FuncPtrModuleAnalysis>;
+    static AnalysisKey Key;
+};
+
+/// 按命令行工具的格式（行号 : 被调函数）打印
+class FuncPtrPrinterPass : public PassInfoMixin<FuncPtrPrinterPass> {
+public:
+    explicit FuncPtrPrinterPass(raw_ostream &out) : out(out) {}
+    // -O0 编出来的函数带 optnone，不标 required 的话新 PassManager 会跳过打印
+    static bool isRequired() { return true; }
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+
+private:
+    raw_ostream &out;
+};
+
+class LivenessPrinterPass : public PassInfoMixin<LivenessPrinterPass> {
+public:
+    explicit LivenessPrinterPass(raw_ostream &out) : out(out) {}
+    static bool isRequired() { return true; }
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM);
+
+private:
+    raw_ostream &out;
+};
+
+/// 间接调用提升：用分析出的调用目标改写间接调用。
+/// 目标集合确定完整是指模块里没有函数地址出现在全局变量初始值里（分析不处理初始值），并且目标不是按类型补上的。
+/// - 目标不超过 maxTargets 个、集合完整：前面的目标改成 "if (fp == f1) f1(...) else if ..." 的比较分支链，
+///   最后一个目标不用比较，直接调用；只有一个目标时就是一条普通的直接调用；
+/// - 目标不超过 maxTargets 个、集合不确定完整：每个目标都比较，最后的 else 里保留原来的间接调用；
+/// - 目标更多或者签名不兼容无法提升：保留间接调用。
+/// 集合完整时挂 !callees 元数据，留下来的间接调用后续的内联、去虚化还能用。
+/// 分析假设入口函数就是整个程序，从入口走不到的调用点没有目标，不做改动。
+class FuncPtrPromotionPass : public PassInfoMixin<FuncPtrPromotionPass> {
+public:
+    explicit FuncPtrPromotionPass(unsigned maxTargets = 4) : maxTargets(maxTargets) {}
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+
+    unsigned numPromoted = 0;  // 提升了的调用点个数
+    unsigned numAnnotated = 0; // 挂上 !callees 的调用点个数
+
+private:
+    unsigned maxTargets;
+};
+
+namespace llvm {
+class PassBuilder;
+}
+
+/// 注册分析（funcptr、liveness）以及 pipeline 名字 print-funcptr、print-liveness、promote-funcptr
+void registerFuncPtrPasses(PassBuilder &PB);
+
+#endif //ASSIGN3_FUNC_PTR_PASSES_H
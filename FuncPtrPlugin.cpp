@@ -0,0 +1,17 @@
+//===- FuncPtrPlugin.cpp - opt plugin entry for the funcptr passes -------===//
+//
+// opt -load-pass-plugin ./FuncPtrPlugin.so -passes='mem2reg,print-funcptr' x.bc
+//
+//===----------------------------------------------------------------------===//
+
+#include "FuncPtrPasses.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+
+using namespace llvm;
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo llvmGetPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "FuncPtr", LLVM_VERSION_STRING, registerFuncPtrPasses};
+}
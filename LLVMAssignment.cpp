@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/IRReader/IRReader.h>
 #include <llvm/IR/LLVMContext.h>
@@ -29,12 +31,23 @@
 #include <llvm/IR/Function.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Path.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <thread>
 
 #include "Liveness.h"
 #include "Dataflow.h"
 #include "PointTo.h"
+#include "FuncPtrAnalysis.h"
+#include "AnalysisCache.h"
+#include "ResultsFile.h"
+#include "Summary.h"
 
 
 using namespace llvm;
@@ -67,28 +80,99 @@ char EnableFunctionOptPass::ID = 0;
 //    y = *x 对应于 load 指令。
 // !其他语句对指针集无影响
 
+static cl::opt<bool>
+NoSlice("no-slice",
+        cl::desc("Analyse every store/load/GEP instead of only those relevant to function pointers"),
+        cl::init(false));
+
+static cl::opt<bool>
+NoTypeFilter("no-type-filter",
+             cl::desc("Analyse every candidate of an indirect call, including those whose type does not match the call"),
+             cl::init(false));
+
+static cl::opt<bool>
+Lazy("lazy",
+     cl::desc("Load bitcode lazily and materialize only functions reached from the entry function"),
+     cl::init(false));
+
+static cl::opt<unsigned>
+TimeBudget("time-budget",
+           cl::desc("Stop solving after this many milliseconds and fall back to type-based targets"),
+           cl::value_desc("ms"),
+           cl::init(0));
+
+static cl::opt<unsigned>
+MemoryBudget("memory-budget",
+             cl::desc("Stop solving once malloc'd memory exceeds this many MB and fall back to type-based targets"),
+             cl::value_desc("MB"),
+             cl::init(0));
+
+static cl::opt<unsigned>
+IterationBudget("iteration-budget",
+                cl::desc("Stop solving after this many basic block visits and fall back to type-based targets"),
+                cl::init(0));
+
+static cl::opt<unsigned>
+CallDepthBudget("call-depth-budget",
+                cl::desc("Analyse callees at most this many calls below the entry function; deeper calls fall back to type-based targets"),
+                cl::init(0));
+
+static cl::opt<unsigned>
+MaxPointsTo("max-points-to",
+            cl::desc("Collapse sets holding more functions than this into any address-taken function of the call's type (0: no limit)"),
+            cl::init(64));
+
+/// 四个预算选项，都没设时 any() 为 false
+static AnalysisBudget budgetFromOptions() {
+    AnalysisBudget budget;
+    budget.timeMs = TimeBudget;
+    budget.memoryMB = MemoryBudget;
+    budget.blockVisits = IterationBudget;
+    budget.callDepth = CallDepthBudget;
+    return budget;
+}
+
 struct FuncPtrPass : public ModulePass {
     static char ID; // Pass identification, replacement for typeid
-    FuncPtrPass() : ModulePass(ID) {}
+    raw_ostream &out;  // 结果输出到哪里，批处理时每个文件各自一个
+    // 懒加载模式下加载函数体（并做 mem2reg）的回调，见 runFuncPtrPass
+    std::function<void(Function *)> materialize;
+    // 不为空时用调用者提供的 analysis，分析完以后结果留在里面供查询（服务模式）
+    FuncPtrAnalysis *external;
+    // 不为空时记录分析统计（-stats）
+    AnalysisStats *stats = nullptr;
+    // 不为空时记录时间线（-trace）
+    TraceRecorder *trace = nullptr;
+    // 不为空时按阶段和函数记录硬件计数器（-perf-counters）
+    PerfProfile *perf = nullptr;
+    FuncPtrPass(raw_ostream &out = errs(), std::function<void(Function *)> materialize = nullptr,
+                FuncPtrAnalysis *external = nullptr)
+        : ModulePass(ID), out(out), materialize(std::move(materialize)), external(external) {}
 
     // 首先根据简单约束条件完成初始约束图和worklist的创建，然后根据复杂约束遍历worklist来添加pts元素，最后得到所有可能的指针指向
     /// 2023-12-16 还有 28 30 31 33 34
     bool runOnModule(Module &M) override {
-        PointToVisitor visitor;
-        DataflowResult<PointToInfo>::Type result;
-        PointToInfo initval;
+        FuncPtrAnalysis local;
+        FuncPtrAnalysis &analysis = external ? *external : local;
 
-        //  找到这个Module里面的最后一个定义的函数（在c文件里的最后一个）
-        auto f = M.rbegin(), e = M.rend();
-        while ((f->isIntrinsic() || f->size() == 0) && f != e)  {
-            f++;
+        FuncPtrAnalysis::Options options;
+        options.slice = !NoSlice;
+        options.typeFilter = !NoTypeFilter;
+        options.keepStates = external != nullptr;
+        options.materialize = materialize;
+        options.stats = stats;
+        options.trace = trace;
+        options.perf = perf;
+        options.budget = budgetFromOptions();
+        options.maxPointsTo = MaxPointsTo;
+        {
+            PerfProfile::Scope fixpoint(perf, perf ? perf->phase("fixpoint") : nullptr);
+            analysis.run(M, options);
         }
 
-        LOG_DEBUG("Entry function: " << f->getName());
-        compForwardDataflow(&*f, &visitor, &result, initval);
-
         // printDataflowResult<PointToInfo>(errs(), result);
-        visitor.printResults(errs());
+        PerfProfile::Scope output(perf, perf ? perf->phase("output") : nullptr);
+        analysis.printResults(out);
         return false;
     }
 };
@@ -100,11 +184,410 @@ static RegisterPass<FuncPtrPass> X("funcptrpass", "Print function call instructi
 char Liveness::ID = 0;
 static RegisterPass<Liveness> Y("liveness", "Liveness Dataflow Analysis");
 
+static cl::list<std::string>
+InputFilenames(cl::Positional,
+               cl::desc("<filename>.bc | <directory> ..."),
+               cl::ZeroOrMore);
+
+static cl::opt<bool>
+Server("server",
+       cl::desc("Keep analysed modules resident and answer JSON-line queries on stdin/stdout"),
+       cl::init(false));
+
+static cl::opt<unsigned>
+Jobs("j",
+     cl::desc("Number of worker threads in batch mode (default: hardware concurrency)"),
+     cl::init(0));
+
+static cl::opt<std::string>
+CacheDir("cache-dir",
+         cl::desc("Directory of cached results, keyed by the IR hashes of the entry function and its dependencies"),
+         cl::value_desc("directory"),
+         cl::init(""));
+
+static cl::opt<std::string>
+EmitResults("emit-results",
+            cl::desc("Also write the results in the binary format of ResultsFile.h"),
+            cl::value_desc("file"),
+            cl::init(""));
+
+static cl::opt<bool>
+EmitPointsTo("emit-points-to",
+             cl::desc("Include the points-to sets at the exit of every block in -emit-results"),
+             cl::init(false));
+
+static cl::opt<std::string>
+ReadResults("read-results",
+            cl::desc("Print the line results stored in a binary results file and exit"),
+            cl::value_desc("file"),
+            cl::init(""));
+
+static cl::opt<std::string>
+EmitSummary("emit-summary",
+            cl::desc("Write a per-TU summary for a later -link step instead of printing results"),
+            cl::value_desc("file"),
+            cl::init(""));
+
 static cl::opt<std::string>
-InputFilename(cl::Positional,
-              cl::desc("<filename>.bc"),
-              cl::init(""));
+TraceFile("trace",
+          cl::desc("Write a Chrome trace-event timeline of the analysis (chrome://tracing, ui.perfetto.dev)"),
+          cl::value_desc("file"),
+          cl::init(""));
+
+// -trace 打开时所有模块（批处理时所有线程）记到同一条时间线上，退出前写出
+static std::unique_ptr<TraceRecorder> Tracer;
+
+static cl::opt<bool>
+PerfCountersOpt("perf-counters",
+                cl::desc("Report hardware performance counters (perf_event_open) per phase and for the heaviest functions"),
+                cl::init(false));
+
+static cl::opt<bool>
+Link("link",
+     cl::desc("Treat the inputs as -emit-summary files, merge them and print the resolved call targets"),
+     cl::init(false));
+
+/// 按 -lazy 选择完整解析还是懒加载
+static std::unique_ptr<Module> loadModule(const std::string &filename, SMDiagnostic &Err,
+                                          LLVMContext &Context) {
+   if (Lazy) {
+      return getLazyIRFileModule(filename, Err, Context);
+   }
+   return parseIRFile(filename, Err, Context);
+}
+
+static PerfProfile::Reading *perfPhase(PerfProfile *profile, const char *name) {
+   return profile ? profile->phase(name) : nullptr;
+}
+
+/// 对一个已经加载好的 Module 跑 mem2reg 和 FuncPtrPass，结果写到 out
+/// 懒加载的模块不能整体跑 mem2reg（函数体还没加载），改成每加载一个函数就单独对它跑一次
+/// profile 不为空时 mem2reg、求解和输出分别记到各自的阶段上，最后把报告写到 out
+static void runFuncPtrPass(Module &M, raw_ostream &out, FuncPtrAnalysis *analysis = nullptr,
+                           PerfProfile *profile = nullptr) {
+   TraceScope moduleSpan(Tracer.get(), "module", M.getSourceFileName());
+   // 缓存只存打印出来的结果，服务模式需要保留分析状态，不走缓存。
+   // 设了预算时结果取决于这次跑得多快，也不走缓存。
+   // 键要在 mem2reg 之前算，缓存命中时连 mem2reg 都不用跑
+   std::unique_ptr<AnalysisCache> cache;
+   std::string cacheKey;
+   if (!CacheDir.empty() && !analysis && !budgetFromOptions().any()) {
+      cache.reset(new AnalysisCache(CacheDir));
+      std::string settings = "max-points-to=" + std::to_string(MaxPointsTo);
+      if (NoTypeFilter) settings += " no-type-filter";
+      cacheKey = cache->keyFor(M, FuncPtrAnalysis::findEntryFunction(M), settings);
+      std::string cached;
+      if (cache->lookup(cacheKey, cached)) {
+         out << cached;
+         return;
+      }
+   }
+   std::string output;
+   raw_string_ostream resultOut(output);
+
+   std::unique_ptr<legacy::FunctionPassManager> FPM;
+   std::function<void(Function *)> materialize;
+   if (Lazy) {
+      FPM.reset(new legacy::FunctionPassManager(&M));
+#if LLVM_VERSION_MAJOR == 5
+      FPM->add(new EnableFunctionOptPass());
+#endif
+      FPM->add(llvm::createPromoteMemoryToRegisterPass());
+      FPM->doInitialization();
+      // FunctionPassManager::run 会先加载函数体
+      materialize = [&FPM, profile](Function *F) {
+         PerfProfile::Scope scope(profile, perfPhase(profile, "mem2reg"));
+         FPM->run(*F);
+      };
+   }
+
+   // mem2reg 单独跑一个 PassManager，计数器才能分开记
+   if (!Lazy) {
+      PerfProfile::Scope scope(profile, perfPhase(profile, "mem2reg"));
+      llvm::legacy::PassManager Prepare;
+#if LLVM_VERSION_MAJOR == 5
+      Prepare.add(new EnableFunctionOptPass());
+#endif
+      ///Transform it to SSA
+      Prepare.add(llvm::createPromoteMemoryToRegisterPass());
+      Prepare.run(M);
+   }
+
+   // -stats 是 LLVM 自带的选项，打开时除了 LLVM 自己的 Statistic 以外也输出分析的统计
+   std::unique_ptr<AnalysisStats> stats;
+   if (AreStatisticsEnabled()) {
+      stats.reset(new AnalysisStats());
+   }
+
+   /// Your pass to print Function and Call Instructions
+   FuncPtrPass *pass = new FuncPtrPass(resultOut, materialize, analysis);
+   pass->stats = stats.get();
+   pass->trace = Tracer.get();
+   pass->perf = profile;
+   llvm::legacy::PassManager Passes;
+   Passes.add(pass);
+   Passes.run(M);
+
+   if (FPM) {
+      FPM->doFinalization();
+   }
+
+   out << resultOut.str();
+   if (cache) {
+      cache->store(cacheKey, output);
+   }
+   if (stats) {
+      stats->print(out);
+   }
+   if (profile) {
+      profile->print(out);
+   }
+}
+
+/// 展开输入列表：目录按文件名排序后取里面的 .bc / .ll 文件（同名的两种都有时只取 .bc），普通文件原样保留
+static std::vector<std::string> collectInputs(const std::vector<std::string> &inputs) {
+    std::vector<std::string> files;
+    for (const std::string &input : inputs) {
+        if (!sys::fs::is_directory(input)) {
+            files.push_back(input);
+            continue;
+        }
+        // 同一个程序常常同时有 .bc 和 .ll 两份，每个文件名只取一份，优先 .bc
+        std::map<std::string, std::string> entries;
+        std::error_code EC;
+        for (sys::fs::directory_iterator it(input, EC), end; it != end && !EC; it.increment(EC)) {
+            StringRef path = it->path();
+            StringRef ext = sys::path::extension(path);
+            if (ext != ".bc" && ext != ".ll") continue;
+            std::string &chosen = entries[path.drop_back(ext.size()).str()];
+            if (chosen.empty() || ext == ".bc") {
+                chosen = path.str();
+            }
+        }
+        for (const auto &entry : entries) {
+            files.push_back(entry.second);
+        }
+    }
+    return files;
+}
+
+/// 批处理：每个文件在工作线程上用自己的 LLVMContext 解析和分析，
+/// 全部完成后按输入顺序输出，每个文件前面加一行 "==> 文件名 <=="
+static int runBatch(const std::vector<std::string> &files) {
+    std::vector<std::string> outputs(files.size());
+    std::vector<char> failed(files.size(), 0);
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            LLVMContext Context;
+            SMDiagnostic Err;
+            raw_string_ostream out(outputs[i]);
+            // 计数器只统计打开它的线程，每个输入在自己的工作线程上建一个
+            std::unique_ptr<PerfProfile> profile(PerfCountersOpt ? new PerfProfile() : nullptr);
+            std::unique_ptr<Module> M;
+            {
+                PerfProfile::Scope scope(profile.get(), perfPhase(profile.get(), "parse"));
+                M = loadModule(files[i], Err, Context);
+            }
+            if (!M) {
+                Err.print("assignment3", out);
+                failed[i] = 1;
+            } else {
+                runFuncPtrPass(*M, out, nullptr, profile.get());
+            }
+            out.flush();
+        }
+    };
+
+    unsigned numThreads = Jobs ? Jobs : std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min<size_t>(numThreads, std::max<size_t>(files.size(), 1));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        errs() << "==> " << files[i] << " <==\n" << outputs[i];
+        ret |= failed[i];
+    }
+    return ret;
+}
+
+
+/// 服务模式里常驻的一个模块：LLVMContext、Module 和求解完保留了状态的分析
+struct ResidentModule {
+    std::unique_ptr<LLVMContext> context;
+    std::unique_ptr<Module> module;
+    std::unique_ptr<FuncPtrAnalysis> analysis;
+    sys::TimePoint<> modified;
+};
+
+/// 和 operator<<(raw_ostream &, const std::set<Value *> &) 里的命名方式一致
+static std::string valueName(const Value *val) {
+    if (!val) return "null";
+    if (PointToInfo::isTop(val)) return "<top>";
+    if (!val->hasName()) return "%*";
+    return (isa<GlobalValue>(val) ? "@" : "%") + val->getName().str();
+}
+
+static json::Array valueNames(const std::set<const Value *> &values) {
+    json::Array names;
+    for (const Value *val : values) names.push_back(valueName(val));
+    return names;
+}
+
+/// 常驻服务：每行一个 JSON 请求，每行一个 JSON 响应。
+///   {"cmd": "load",     "file": F}                                    加载并求解（已加载且文件没变时直接返回）
+///   {"cmd": "reload",   "file": F}                                    强制重新加载并求解
+///   {"cmd": "unload",   "file": F}
+///   {"cmd": "callees",  "file": F, "line": N}                         这一行调用了哪些函数，"degraded" 表示是按类型退化的结果
+///   {"cmd": "pointsto", "file": F, "function": G, "value": V}         G 出口处 %V 的指向集合和别名，
+///                                                                     和 FuncPtrAnalysis::getPointsTo / getAliases 一样
+///   {"cmd": "shutdown"}
+/// 查询前会检查文件修改时间，文件变了就自动重新分析。请求里的 "id" 原样带回。
+class AnalysisServer {
+public:
+    json::Object handle(const json::Object &request, bool &quit) {
+        auto cmd = request.getString("cmd");
+        if (!cmd) return error("missing \"cmd\"");
+        if (*cmd == "shutdown") {
+            quit = true;
+            return json::Object{{"ok", true}};
+        }
+
+        auto file = request.getString("file");
+        if (!file) return error("missing \"file\"");
+        if (*cmd == "unload") {
+            modules.erase(file->str());
+            return json::Object{{"ok", true}};
+        }
+
+        std::string err;
+        ResidentModule *resident = get(file->str(), *cmd == "reload", err);
+        if (!resident) return error(err);
+        PointToVisitor &visitor = resident->analysis->getVisitor();
+
+        if (*cmd == "load" || *cmd == "reload") {
+            return json::Object{{"ok", true},
+                                {"functions", (int64_t)visitor.functionStates.size()},
+                                {"callSites", (int64_t)visitor.callSiteTargets.size()}};
+        }
+
+        if (*cmd == "callees") {
+            auto line = request.getInteger("line");
+            if (!line) return error("missing \"line\"");
+            json::Array callees;
+            auto it = visitor.results.find((unsigned)*line);
+            if (it != visitor.results.end()) {
+                for (const std::string &name : it->second) callees.push_back(name);
+            }
+            bool degraded = visitor.degradedLines.count((unsigned)*line);
+            return json::Object{{"ok", true}, {"line", *line}, {"callees", std::move(callees)}, {"degraded", degraded}};
+        }
+
+        if (*cmd == "pointsto") {
+            auto fnName = request.getString("function");
+            auto valName = request.getString("value");
+            if (!fnName || !valName) return error("missing \"function\" or \"value\"");
+            Function *fn = resident->module->getFunction(*fnName);
+            if (!fn) return error("no function " + fnName->str());
+            auto states = visitor.functionStates.find(fn);
+            if (states == visitor.functionStates.end() || fn->empty()) {
+                return error("function " + fnName->str() + " is not reached from the entry function");
+            }
+            Value *val = findValue(fn, *valName);
+            if (!val) return error("no value " + valName->str() + " in " + fnName->str());
+
+            // 参数和指令按库接口的默认位置，取所在函数（就是 G）的出口；
+            // 全局变量不属于任何函数，取 G 最后一个基本块的结尾指令之前
+            const Instruction *at = isa<GlobalValue>(val) ? fn->back().getTerminator() : nullptr;
+            FuncPtrAnalysis &analysis = *resident->analysis;
+            return json::Object{{"ok", true},
+                                {"pointsTo", valueNames(analysis.getPointsTo(val, at))},
+                                {"aliases", valueNames(analysis.getAliases(val, at))}};
+        }
+
+        return error("unknown cmd " + cmd->str());
+    }
+
+private:
+    std::map<std::string, ResidentModule> modules;
+
+    static json::Object error(const std::string &message) {
+        return json::Object{{"ok", false}, {"error", message}};
+    }
+
+    static Value *findValue(Function *fn, StringRef name) {
+        for (Argument &arg : fn->args()) {
+            if (arg.getName() == name) return &arg;
+        }
+        for (BasicBlock &bb : *fn) {
+            for (Instruction &inst : bb) {
+                if (inst.getName() == name) return &inst;
+            }
+        }
+        return fn->getParent()->getNamedValue(name);
+    }
+
+    ResidentModule *get(const std::string &file, bool reload, std::string &err) {
+        sys::fs::file_status status;
+        if (std::error_code EC = sys::fs::status(file, status)) {
+            err = file + ": " + EC.message();
+            return nullptr;
+        }
+        auto it = modules.find(file);
+        if (it != modules.end() && !reload && it->second.modified == status.getLastModificationTime()) {
+            return &it->second;
+        }
+
+        ResidentModule resident;
+        resident.context.reset(new LLVMContext());
+        SMDiagnostic Err;
+        resident.module = loadModule(file, Err, *resident.context);
+        if (!resident.module) {
+            raw_string_ostream out(err);
+            Err.print("assignment3", out);
+            out.flush();
+            return nullptr;
+        }
+        resident.analysis.reset(new FuncPtrAnalysis());
+        runFuncPtrPass(*resident.module, nulls(), resident.analysis.get());
+        resident.modified = status.getLastModificationTime();
+
+        // analysis 里的指针指向旧的 Module，要先于旧的 context 释放，所以整体替换
+        if (it != modules.end()) modules.erase(it);
+        return &(modules[file] = std::move(resident));
+    }
+};
 
+static int runServer() {
+    AnalysisServer server;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+        bool quit = false;
+        json::Object response;
+        Expected<json::Value> request = json::parse(line);
+        if (!request) {
+            response = json::Object{{"ok", false}, {"error", toString(request.takeError())}};
+        } else if (const json::Object *object = request->getAsObject()) {
+            response = server.handle(*object, quit);
+            if (const json::Value *id = object->get("id")) response["id"] = *id;
+        } else {
+            response = json::Object{{"ok", false}, {"error", "request must be a JSON object"}};
+        }
+        outs() << json::Value(std::move(response)) << "\n";
+        outs().flush();
+        if (quit) break;
+    }
+    return 0;
+}
 
 int main(int argc, char **argv) {
     LLVMContext &Context = getGlobalContext();
@@ -126,24 +609,92 @@ int main(int argc, char **argv) {
                                 "FuncPtrPass \n My first LLVM too which does not do much.\n");
     }
 
+   if (Server) {
+      return runServer();
+   }
+
+   if (!TraceFile.empty()) {
+      Tracer.reset(new TraceRecorder());
+   }
+   auto writeTrace = make_scope_exit([&]() {
+      if (!Tracer) return;
+      std::string error = Tracer->write(TraceFile);
+      if (!error.empty()) {
+         errs() << argv[0] << ": " << TraceFile << ": " << error << "\n";
+      }
+   });
+
+   if (!ReadResults.empty()) {
+      std::string error;
+      std::unique_ptr<ResultsFile::Reader> reader = ResultsFile::Reader::open(ReadResults, error);
+      if (!reader) {
+         errs() << argv[0] << ": " << ReadResults << ": " << error << "\n";
+         return 1;
+      }
+      reader->printLines(errs());
+      return 0;
+   }
+
+   if (Link) {
+      Summary::Linker linker;
+      for (const std::string &file : InputFilenames) {
+         std::string error = linker.add(file);
+         if (!error.empty()) {
+            errs() << argv[0] << ": " << file << ": " << error << "\n";
+            return 1;
+         }
+      }
+      linker.link(errs());
+      return 0;
+   }
+
+   // 多个输入或者输入是目录时走批处理
+   std::vector<std::string> files = collectInputs(InputFilenames);
+   if (files.size() != 1 || InputFilenames.size() != 1 || files[0] != InputFilenames[0]) {
+      return runBatch(files);
+   }
+
    // Load the input module
-   std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
+   std::unique_ptr<PerfProfile> profile(PerfCountersOpt ? new PerfProfile() : nullptr);
+   std::unique_ptr<Module> M;
+   {
+      PerfProfile::Scope scope(profile.get(), perfPhase(profile.get(), "parse"));
+      M = loadModule(files[0], Err, Context);
+   }
    if (!M) {
       Err.print(argv[0], errs());
       return 1;
    }
 
-   llvm::legacy::PassManager Passes;
-#if LLVM_VERSION_MAJOR == 5
-   Passes.add(new EnableFunctionOptPass());
-#endif
-   ///Transform it to SSA
-   Passes.add(llvm::createPromoteMemoryToRegisterPass());
+   if (!EmitSummary.empty()) {
+      // 摘要需要每个调用点的目标，本地结果不打印
+      FuncPtrAnalysis analysis;
+      std::string discarded;
+      raw_string_ostream discard(discarded);
+      runFuncPtrPass(*M, discard, &analysis, profile.get());
+      std::error_code EC;
+      raw_fd_ostream out(EmitSummary, EC, sys::fs::OF_None);
+      if (EC) {
+         errs() << argv[0] << ": " << EmitSummary << ": " << EC.message() << "\n";
+         return 1;
+      }
+      out << Summary::build(*M, analysis) << "\n";
+      return 0;
+   }
 
-   /// Your pass to print Function and Call Instructions
-   Passes.add(new FuncPtrPass());
-   //Passes.add(new FuncPtrPass());
-   Passes.run(*M.get());
+   if (EmitResults.empty()) {
+      runFuncPtrPass(*M, errs(), nullptr, profile.get());
+      return 0;
+   }
+
+   // 写二进制结果需要保留每个调用点和基本块的状态
+   FuncPtrAnalysis analysis;
+   runFuncPtrPass(*M, errs(), &analysis, profile.get());
+   std::string error = ResultsFile::Writer(analysis, *M).write(EmitResults, EmitPointsTo);
+   if (!error.empty()) {
+      errs() << argv[0] << ": " << EmitResults << ": " << error << "\n";
+      return 1;
+   }
 #ifndef NDEBUG
 
 #endif
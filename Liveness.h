@@ -12,6 +12,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#ifndef ASSIGN3_LIVENESS_H
+#define ASSIGN3_LIVENESS_H
+
 #include <llvm/IR/Function.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
@@ -23,14 +26,49 @@ using namespace llvm;
 
 struct LivenessInfo {
    std::set<Instruction *> LiveVars;             /// Set of variables which are live
-   LivenessInfo() : LiveVars() {}
-   LivenessInfo(const LivenessInfo & info) : LiveVars(info.LiveVars) {}
-  
+   uint64_t fingerprint;                          /// XOR of fingerprintOf over LiveVars
+   LivenessInfo() : LiveVars(), fingerprint(0) {}
+   LivenessInfo(const LivenessInfo & info) : LiveVars(info.LiveVars), fingerprint(info.fingerprint) {}
+
+   /// LiveVars 只能通过 insert / erase 修改，以维护 fingerprint
+   bool insert(Instruction *inst) {
+       if (!LiveVars.insert(inst).second) return false;
+       fingerprint ^= fingerprintOf(0, inst);
+       return true;
+   }
+
+   bool erase(Instruction *inst) {
+       if (!LiveVars.erase(inst)) return false;
+       fingerprint ^= fingerprintOf(0, inst);
+       return true;
+   }
+
+   size_t entryCount() const {
+       return LiveVars.size();
+   }
+
+   uint64_t computeFingerprint() const {
+       uint64_t fp = 0;
+       for (Instruction *inst : LiveVars) fp ^= fingerprintOf(0, inst);
+       return fp;
+   }
+
    bool operator == (const LivenessInfo & info) const {
-       return LiveVars == info.LiveVars;
+#ifdef CHECK_FINGERPRINT
+       assert(fingerprint == computeFingerprint() && info.fingerprint == info.computeFingerprint());
+       bool equal = LiveVars == info.LiveVars;
+       assert(!equal || fingerprint == info.fingerprint);
+       return equal;
+#else
+       return fingerprint == info.fingerprint && LiveVars == info.LiveVars;
+#endif
    }
 };
 
+inline size_t heapBytes(const LivenessInfo &info) {
+    return heapBytes(info.LiveVars);
+}
+
 inline raw_ostream &operator<<(raw_ostream &out, const LivenessInfo &info) {
     for (std::set<Instruction *>::iterator ii=info.LiveVars.begin(), ie=info.LiveVars.end();
          ii != ie; ++ ii) {
@@ -48,18 +86,18 @@ public:
    void merge(LivenessInfo * dest, const LivenessInfo & src) override {
        for (std::set<Instruction *>::const_iterator ii = src.LiveVars.begin(), 
             ie = src.LiveVars.end(); ii != ie; ++ii) {
-           dest->LiveVars.insert(*ii);
+           dest->insert(*ii);
        }
    }
 
    void compDFVal(Instruction *inst, LivenessInfo * dfval) override{
         if (isa<DbgInfoIntrinsic>(inst)) return;
-        dfval->LiveVars.erase(inst);
+        dfval->erase(inst);
         for(User::op_iterator oi = inst->op_begin(), oe = inst->op_end();
             oi != oe; ++oi) {
            Value * val = *oi;
            if (isa<Instruction>(val)) 
-               dfval->LiveVars.insert(cast<Instruction>(val));
+               dfval->insert(cast<Instruction>(val));
        }
    }
 };
@@ -83,5 +121,4 @@ public:
    }
 };
 
-
-
+#endif //ASSIGN3_LIVENESS_H
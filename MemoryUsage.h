@@ -0,0 +1,77 @@
+#ifndef ASSIGN3_MEMORY_USAGE_H
+#define ASSIGN3_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// 估算容器在堆上占用的字节数（不含对象本身的 sizeof），给 -stats 的内存统计用。
+///
+/// 按 libstdc++ 和 glibc malloc 的布局估算：红黑树每个节点是 32 字节的节点头加上元素，
+/// 每次分配再加 8 字节的块头并向上对齐到 16 字节，最小 32 字节。只遍历容器，不改变分配行为，
+/// 所以结果是估计值，但同一个程序里各部分之间的比例是可靠的。
+///
+/// 分析里自己的类型（PointToInfo、LivenessInfo 等）在各自的头文件里提供 heapBytes 重载。
+namespace MemoryUsage {
+
+inline size_t allocation(size_t bytes) {
+    if (bytes == 0) return 0;
+    size_t chunk = (bytes + 8 + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+const size_t TreeNodeHeader = 32;
+
+} // namespace MemoryUsage
+
+// 指针和标量不拥有堆内存
+template <class T>
+typename std::enable_if<std::is_pointer<T>::value || std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                        size_t>::type
+heapBytes(const T &) {
+    return 0;
+}
+
+inline size_t heapBytes(const std::string &str) {
+    // 短字符串存在对象内部
+    return str.capacity() > 15 ? MemoryUsage::allocation(str.capacity() + 1) : 0;
+}
+
+template <class A, class B> size_t heapBytes(const std::pair<A, B> &pair);
+template <class T> size_t heapBytes(const std::set<T> &set);
+template <class K, class V> size_t heapBytes(const std::map<K, V> &map);
+template <class T> size_t heapBytes(const std::vector<T> &vec);
+
+template <class A, class B>
+size_t heapBytes(const std::pair<A, B> &pair) {
+    return heapBytes(pair.first) + heapBytes(pair.second);
+}
+
+template <class T>
+size_t heapBytes(const std::set<T> &set) {
+    size_t bytes = set.size() * MemoryUsage::allocation(MemoryUsage::TreeNodeHeader + sizeof(T));
+    if (!std::is_pointer<T>::value && !std::is_arithmetic<T>::value) {
+        for (const T &item : set) bytes += heapBytes(item);
+    }
+    return bytes;
+}
+
+template <class K, class V>
+size_t heapBytes(const std::map<K, V> &map) {
+    size_t bytes = map.size() * MemoryUsage::allocation(MemoryUsage::TreeNodeHeader + sizeof(std::pair<const K, V>));
+    for (const auto &item : map) bytes += heapBytes(item.first) + heapBytes(item.second);
+    return bytes;
+}
+
+template <class T>
+size_t heapBytes(const std::vector<T> &vec) {
+    size_t bytes = MemoryUsage::allocation(vec.capacity() * sizeof(T));
+    for (const T &item : vec) bytes += heapBytes(item);
+    return bytes;
+}
+
+#endif //ASSIGN3_MEMORY_USAGE_H
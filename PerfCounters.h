@@ -0,0 +1,225 @@
+#ifndef ASSIGN3_PERF_COUNTERS_H
+#define ASSIGN3_PERF_COUNTERS_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace llvm;
+
+/// 当前线程的硬件性能计数器（Linux perf_event_open）：cycles、instructions、cache misses、branch misses，
+/// 四个计数器放在一个组里同时调度，被内核复用时按 time_enabled / time_running 放大。
+/// 只统计用户态，不需要 root（perf_event_paranoid <= 2 即可）。打不开时（非 Linux、容器里没有 PMU、
+/// 权限不够）available() 为 false，读数里只有墙钟时间。
+class PerfCounters {
+public:
+    static constexpr unsigned NumCounters = 4;
+
+    struct Reading {
+        uint64_t values[NumCounters] = {};
+        uint64_t nanos = 0;
+
+        Reading &operator+=(const Reading &other) {
+            for (unsigned i = 0; i < NumCounters; i++) values[i] += other.values[i];
+            nanos += other.nanos;
+            return *this;
+        }
+
+        Reading operator-(const Reading &other) const {
+            Reading diff;
+            for (unsigned i = 0; i < NumCounters; i++) {
+                diff.values[i] = values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+            }
+            diff.nanos = nanos > other.nanos ? nanos - other.nanos : 0;
+            return diff;
+        }
+    };
+
+    static const char *counterName(unsigned i) {
+        static const char *names[NumCounters] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+        return names[i];
+    }
+
+    PerfCounters() {
+#ifdef __linux__
+        static const uint64_t configs[NumCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (unsigned i = 0; i < NumCounters; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0;  // 组长关着打开，全部建好后一起开始
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fd < 0) {
+                error = strerror(errno);
+                close();
+                return;
+            }
+            fds[i] = fd;
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+        error = "perf_event_open is only available on Linux";
+#endif
+    }
+
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const { return fds[0] >= 0; }
+
+    /// 打不开时的原因
+    const std::string &getError() const { return error; }
+
+    /// 从打开以来的累计值
+    Reading read() const {
+        Reading reading;
+        reading.nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#ifdef __linux__
+        if (!available()) return reading;
+        // PERF_FORMAT_GROUP: nr, time_enabled, time_running, value[nr]
+        uint64_t buffer[3 + NumCounters];
+        if (::read(fds[0], buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer) || buffer[0] != NumCounters) {
+            return reading;
+        }
+        double scale = buffer[2] ? (double)buffer[1] / buffer[2] : 1.0;
+        for (unsigned i = 0; i < NumCounters; i++) reading.values[i] = (uint64_t)(buffer[3 + i] * scale);
+#endif
+        return reading;
+    }
+
+private:
+    int fds[NumCounters] = {-1, -1, -1, -1};
+    std::string error;
+
+    void close() {
+#ifdef __linux__
+        for (int &fd : fds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+};
+
+/// 按阶段和按函数归集计数器（-perf-counters）。
+///
+/// 阶段（parse、mem2reg、fixpoint、output）和函数（每次 compForwardDataflow）都用 Scope 包起来。
+/// 阶段和函数是两个互不影响的维度，同一维度里嵌套在里面的 Scope 的读数从外层扣掉：
+/// 懒加载时 fixpoint 里按需做的 mem2reg 记在 mem2reg 上，不算进 fixpoint；
+/// 函数的读数只包括它自己的基本块，不包括它递归分析的被调函数。
+/// 计数器只统计打开它的线程，所以每个输入（批处理时在各自的工作线程上）各建一个。
+class PerfProfile {
+public:
+    typedef PerfCounters::Reading Reading;
+
+    enum Level { PhaseLevel, FunctionLevel };
+
+    class Scope {
+    public:
+        /// profile 为空时什么都不做
+        Scope(PerfProfile *profile, Reading *target, Level level = PhaseLevel)
+            : profile(profile), target(target), level(level) {
+            if (!profile) return;
+            savedChild = profile->child[level];
+            profile->child[level] = Reading();
+            start = profile->counters.read();
+        }
+        ~Scope() {
+            if (!profile) return;
+            Reading elapsed = profile->counters.read() - start;
+            *target += elapsed - profile->child[level];
+            profile->child[level] = savedChild;
+            profile->child[level] += elapsed;
+        }
+
+    private:
+        PerfProfile *profile;
+        Reading *target;
+        Level level;
+        Reading start, savedChild;
+    };
+
+    /// 同名阶段的读数累加，按第一次出现的顺序输出
+    Reading *phase(const std::string &name) {
+        for (auto &p : phases) {
+            if (p.first == name) return &p.second;
+        }
+        phases.emplace_back(name, Reading());
+        return &phases.back().second;
+    }
+
+    Reading *function(const Function *fn) { return &functions[fn]; }
+
+    /// 函数名在这里取，所以要在模块释放之前打印
+    void print(raw_ostream &out, unsigned topFunctions = 10) const {
+        out << "===- funcptr perf counters -===\n";
+        if (!counters.available()) {
+            out << "  hardware counters unavailable (" << counters.getError() << "), wall time only\n";
+        }
+        printHeader(out, "phase");
+        for (const auto &p : phases) printRow(out, p.first, p.second);
+
+        std::vector<std::pair<const Function *, Reading>> sorted(functions.begin(), functions.end());
+        // 有硬件计数器时按 cycles 排，否则按墙钟时间
+        bool byCycles = counters.available();
+        std::sort(sorted.begin(), sorted.end(),
+                  [byCycles](const std::pair<const Function *, Reading> &a, const std::pair<const Function *, Reading> &b) {
+                      uint64_t x = byCycles ? a.second.values[0] : a.second.nanos;
+                      uint64_t y = byCycles ? b.second.values[0] : b.second.nanos;
+                      return x != y ? x > y : a.first->getName() < b.first->getName();
+                  });
+        if (sorted.size() > topFunctions) sorted.resize(topFunctions);
+        printHeader(out, "function (self)");
+        for (const auto &fn : sorted) printRow(out, fn.first->getName().str(), fn.second);
+    }
+
+private:
+    PerfCounters counters;
+    Reading child[2];  // 每个维度当前 Scope 里已经结束的嵌套 Scope 的读数之和
+    std::deque<std::pair<std::string, Reading>> phases;  // deque 追加元素时已有元素的地址不变，Scope 里存的是指针
+    std::map<const Function *, Reading> functions;
+
+    void printHeader(raw_ostream &out, const char *title) const {
+        out << format("  %-24s %10s", title, static_cast<const char *>("ms"));
+        for (unsigned i = 0; i < PerfCounters::NumCounters; i++) out << format(" %14s", PerfCounters::counterName(i));
+        out << "\n";
+    }
+
+    void printRow(raw_ostream &out, const std::string &name, const Reading &reading) const {
+        out << format("  %-24s %10.3f", name.c_str(), reading.nanos / 1e6);
+        for (unsigned i = 0; i < PerfCounters::NumCounters; i++) {
+            if (counters.available()) {
+                out << format(" %14llu", (unsigned long long)reading.values[i]);
+            } else {
+                out << format(" %14s", static_cast<const char *>("-"));
+            }
+        }
+        out << "\n";
+    }
+};
+
+#endif //ASSIGN3_PERF_COUNTERS_H
@@ -1,36 +1,91 @@
 #ifndef ASSIGN3_POINT_TO_H
 #define ASSIGN3_POINT_TO_H
 
+#include "Budget.h"
 #include "Dataflow.h"
+#include "Liveness.h"
+#include "Relevance.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include <algorithm>
+#include <functional>
 #include <set>
+#include <vector>
 using namespace llvm;
 
 struct PointToInfo {
     // pointToSets: 一个变量它指向什么
     // binding: 一个变量它等同于什么，可以理解为别名
+    // 两个 map 只能通过下面的 set/add/touch 方法修改，以维护 fingerprint
     std::map<Value *, std::set<Value *>> pointToSets;
     std::map<Value *, std::set<Value *>> bindings; // 存储临时变量绑定关系
 
-    // LiveVars 猜测是可能被指针指向的变量集合
+    // pointToSets 和 bindings 里所有 key 以及 (key, value) 对的指纹异或，见 fingerprintOf
+    uint64_t fingerprint = 0;
+    enum FingerprintTag { PTSKey, PTSEntry, BindingKey, BindingEntry };
+
+    // LiveVars: 当前基本块出口处活跃的 SSA 值，由 PointToVisitor::compDFVal(BasicBlock*) 填写，
+    // 用来裁剪已经死掉的临时变量 binding。只是辅助信息，不参与比较和拷贝。
     std::set<Instruction *> LiveVars;             /// Set of variables which are live
+
+    // binding 解析缓存：值 -> 沿 binding 链解析到的最终目标，以及解析时经过的所有值。
+    // 只是 bindings 的派生数据，不参与比较，也不拷贝：拷贝出来的状态马上就会被修改，缓存多半要作废，
+    // 数据流每个基本块都要拷贝状态，一起拷贝缓存不划算。
+    mutable std::map<Value *, std::set<Value *>> resolvedBindings;
+    mutable std::set<Value *> resolvedTouched;
+
     PointToInfo() : LiveVars() {}
 
+    /// "top"：任何取过地址、类型和用到它的地方相符的函数，在间接调用处按调用的函数类型展开，
+    /// 见 PointToVisitor::handleCallInst。一个集合里的函数超过 limit 个时（修改集合的方法的参数，
+    /// 由调用的 PointToVisitor 按自己的 maxPointsTo 传入），这些函数整体换成 top（集合里的内存对象不受影响）。
+    /// 折叠后的集合很小，之后和它有关的合并、store 都是常数时间，而这时精确的结果本来也和 top 差不多了。
+    /// top 是一个不属于任何模块的 UndefValue，只用来比较地址。
+    static Value *top() {
+        static Value *value = UndefValue::get(Type::getInt8PtrTy(topContext()));
+        return value;
+    }
+
+    /// 和 top 一样展开，但来自没有分析的调用（递归、超过调用深度、预算用完），
+    /// 见 PointToVisitor::havocCall。展开它的调用点标记为退化。
+    static Value *degradedTop() {
+        static Value *value = UndefValue::get(Type::getInt16PtrTy(topContext()));
+        return value;
+    }
+
+    static bool isTop(const Value *val) {
+        return val == top() || val == degradedTop();
+    }
+
+    static bool hasTop(const std::set<Value *> &s) {
+        return s.count(top()) || s.count(degradedTop());
+    }
+
     PointToInfo(const PointToInfo &info) {
         //LOG_DEBUG("Trigger copy constructor!");
         pointToSets = info.pointToSets;
         bindings = info.bindings;
+        fingerprint = info.fingerprint;
     }
 
+    // 指纹不同直接判定不相等，相同时再做完整比较
     bool operator==(const PointToInfo &pts) const {
-        return pointToSets == pts.pointToSets && bindings == pts.bindings;
+#ifdef CHECK_FINGERPRINT
+        assert(fingerprint == computeFingerprint() && pts.fingerprint == pts.computeFingerprint());
+        bool equal = pointToSets == pts.pointToSets && bindings == pts.bindings;
+        assert(!equal || fingerprint == pts.fingerprint);
+        return equal;
+#else
+        return fingerprint == pts.fingerprint && pointToSets == pts.pointToSets && bindings == pts.bindings;
+#endif
     }
 
     bool operator!=(const PointToInfo &pts) const {
-        return pointToSets != pts.pointToSets || bindings != pts.bindings;
+        return !(*this == pts);
     }
 
     // 重载 PointToSet的 = 运算符
@@ -38,34 +93,222 @@ struct PointToInfo {
         //LOG_DEBUG("Trigger = operator!");
         pointToSets = info.pointToSets;
         bindings = info.bindings;
+        fingerprint = info.fingerprint;
+        invalidateResolved();
         return *this;
     }
 
+    // 从头计算指纹，只用于检查增量维护的结果
+    uint64_t computeFingerprint() const {
+        uint64_t fp = 0;
+        for (const auto &pts : pointToSets) {
+            fp ^= fingerprintOf(PTSKey, pts.first);
+            for (Value *v : pts.second) fp ^= fingerprintOf(PTSEntry, pts.first, v);
+        }
+        for (const auto &binding : bindings) {
+            fp ^= fingerprintOf(BindingKey, binding.first);
+            for (Value *v : binding.second) fp ^= fingerprintOf(BindingEntry, binding.first, v);
+        }
+        return fp;
+    }
+
+    // pointToSets 和 bindings 里所有集合的元素总数
+    size_t entryCount() const {
+        size_t count = 0;
+        for (const auto &pts : pointToSets) count += pts.second.size();
+        for (const auto &binding : bindings) count += binding.second.size();
+        return count;
+    }
+
+    // 各部分在堆上占用的字节数（估计值，见 MemoryUsage.h）
+    size_t pointToSetBytes() const { return heapBytes(pointToSets); }
+    size_t bindingBytes() const { return heapBytes(bindings); }
+    size_t otherBytes() const {
+        return heapBytes(LiveVars) + heapBytes(resolvedBindings) + heapBytes(resolvedTouched);
+    }
+
 
     // 查看这个值有没有别名
-    bool hasBinding(Value* value){
+    bool hasBinding(Value* value) const {
         return bindings.find(value) != bindings.end();
     }
 
-    void setBinding(Value * val, std::set<Value *> binding){
-        bindings[val] = binding;
+    // limit: 集合里最多保留几个函数，0 表示不限制，见 top()
+    void setBinding(Value * val, std::set<Value *> binding, unsigned limit){
+        invalidateResolved(val);
+        replaceSet(bindings, BindingKey, BindingEntry, val, std::move(binding), limit);
+    }
+
+    void eraseBinding(Value *val) {
+        auto it = bindings.find(val);
+        if (it == bindings.end()) return;
+        invalidateResolved(val);
+        fingerprint ^= fingerprintOf(BindingKey, val);
+        for (Value *v : it->second) fingerprint ^= fingerprintOf(BindingEntry, val, v);
+        bindings.erase(it);
+    }
+
+    // 把 binding 并入 val 原有的 binding，返回是否有变化
+    bool addBinding(Value *val, const std::set<Value *> &binding, unsigned limit) {
+        auto it = bindings.find(val);
+        if (it != bindings.end()
+            && std::includes(it->second.begin(), it->second.end(), binding.begin(), binding.end())) {
+            return false;
+        }
+        invalidateResolved(val);
+        return unionSet(bindings, BindingKey, BindingEntry, val, binding, limit);
+    }
+
+    // 不存在时返回空集，不会往 bindings 里插入空项
+    std::set<Value *> getBinding(Value* val) const {
+        auto it = bindings.find(val);
+        return it == bindings.end() ? std::set<Value *>() : it->second;
     }
 
-    std::set<Value *> getBinding(Value* val){
-        return bindings[val];
+    // 单步查找：有 binding 返回 binding，没有就是它自身
+    std::set<Value *> getBindingOrSelf(Value *val) const {
+        auto it = bindings.find(val);
+        return it == bindings.end() ? std::set<Value *>{val} : it->second;
+    }
+
+    /// 沿 binding 链解析 val 最终指代的目标集合（没有 binding 的值解析为它自身）。
+    /// 按深度优先遍历 binding 链，每个值的结果记在 resolvedBindings 里，之后同一个值的解析是一次查表，
+    /// 遍历时碰到已经解析过的值也直接用它的结果。解析时经过的值的 binding 一旦改变，整个缓存作废，见 invalidateResolved。
+    /// 链上带环时每个值只访问一次，不会重复处理。
+    const std::set<Value *> &resolveBinding(Value *val) const {
+        auto hit = resolvedBindings.find(val);
+        if (hit != resolvedBindings.end()) {
+            return hit->second;
+        }
+
+        std::set<Value *> targets;
+        std::set<Value *> visited = {val};
+        std::vector<Value *> stack = {val};
+        while (!stack.empty()) {
+            Value *cur = stack.back();
+            stack.pop_back();
+            resolvedTouched.insert(cur);
+
+            auto b = bindings.find(cur);
+            if (b == bindings.end()) {
+                targets.insert(cur);
+                continue;
+            }
+            for (Value *next : b->second) {
+                auto cached = resolvedBindings.find(next);
+                if (cached != resolvedBindings.end()) {
+                    // 已经解析过的值直接拿结果，但仍要记录依赖以便失效
+                    targets.insert(cached->second.begin(), cached->second.end());
+                    resolvedTouched.insert(next);
+                } else if (visited.insert(next).second) {
+                    stack.push_back(next);
+                }
+            }
+        }
+        return resolvedBindings[val] = std::move(targets);
+    }
+
+    // 只有被某次解析访问过的值的 binding 发生变化时，缓存才可能过期
+    void invalidateResolved(Value *val) {
+        if (resolvedTouched.count(val)) {
+            invalidateResolved();
+        }
+    }
+
+    void invalidateResolved() {
+        resolvedBindings.clear();
+        resolvedTouched.clear();
     }
 
     // 仿照上面has,set,get Binding的实现，对PointToSet实现一样的方法
-    bool hasPointToSet(Value* value){
+    bool hasPointToSet(Value* value) const {
         return pointToSets.find(value) != pointToSets.end();
     }
 
-    void setPointToSet(Value * val, std::set<Value *> pointToSet){
-        pointToSets[val] = pointToSet;
+    void setPointToSet(Value * val, std::set<Value *> pointToSet, unsigned limit){
+        replaceSet(pointToSets, PTSKey, PTSEntry, val, std::move(pointToSet), limit);
+    }
+
+    // 把 pointToSet 并入 val 原有的 PTS，返回是否有变化
+    bool addPointToSet(Value *val, const std::set<Value *> &pointToSet, unsigned limit) {
+        return unionSet(pointToSets, PTSKey, PTSEntry, val, pointToSet, limit);
+    }
+
+    std::set<Value *> getPointToSet(Value* val) const {
+        auto it = pointToSets.find(val);
+        return it == pointToSets.end() ? std::set<Value *>() : it->second;
+    }
+
+    // 和 pointToSets[val] 一样，不存在时插入一个空集
+    const std::set<Value *> &touchPointToSet(Value *val) {
+        return touchSet(pointToSets, PTSKey, val);
+    }
+
+private:
+    typedef std::map<Value *, std::set<Value *>> SetMap;
+
+    std::set<Value *> &touchSet(SetMap &m, unsigned keyTag, Value *key) {
+        auto it = m.find(key);
+        if (it == m.end()) {
+            fingerprint ^= fingerprintOf(keyTag, key);
+            it = m.insert(std::make_pair(key, std::set<Value *>())).first;
+        }
+        return it->second;
+    }
+
+    void replaceSet(SetMap &m, unsigned keyTag, unsigned entryTag, Value *key, std::set<Value *> s, unsigned limit) {
+        std::set<Value *> &old = touchSet(m, keyTag, key);
+        for (Value *v : old) fingerprint ^= fingerprintOf(entryTag, key, v);
+        for (Value *v : s) fingerprint ^= fingerprintOf(entryTag, key, v);
+        old = std::move(s);
+        collapseFunctions(old, entryTag, key, limit);
+    }
+
+    bool unionSet(SetMap &m, unsigned keyTag, unsigned entryTag, Value *key, const std::set<Value *> &s,
+                  unsigned limit) {
+        std::set<Value *> &old = touchSet(m, keyTag, key);
+        // 已经是 top 的集合再并入函数不会变化
+        bool hasTop = PointToInfo::hasTop(old);
+        // 来源也折叠过、只剩 top（折叠后的集合里除了 top 没有函数）而且已经在里面时不会变化，不用逐个看
+        if (hasTop && s.size() == 1 && old.count(*s.begin())) {
+            return false;
+        }
+        bool changed = false;
+        for (Value *v : s) {
+            if (hasTop && isa<Function>(v)) continue;
+            if (old.insert(v).second) {
+                fingerprint ^= fingerprintOf(entryTag, key, v);
+                changed = true;
+            }
+        }
+        if (changed) collapseFunctions(old, entryTag, key, limit);
+        return changed;
+    }
+
+    /// 集合里有 top，或者函数超过上限时，去掉所有函数，只留 top
+    void collapseFunctions(std::set<Value *> &s, unsigned entryTag, Value *key, unsigned limit) {
+        if (!PointToInfo::hasTop(s)) {
+            if (!limit || s.size() <= limit) return;
+            if ((unsigned)std::count_if(s.begin(), s.end(), [](Value *v) { return isa<Function>(v); }) <= limit) {
+                return;
+            }
+            s.insert(top());
+            fingerprint ^= fingerprintOf(entryTag, key, top());
+        }
+        for (auto it = s.begin(); it != s.end();) {
+            if (isa<Function>(*it)) {
+                fingerprint ^= fingerprintOf(entryTag, key, *it);
+                it = s.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
 
-    std::set<Value *> getPointToSet(Value* val){
-        return pointToSets[val];
+    static LLVMContext &topContext() {
+        // 故意不释放，退出时不用考虑析构顺序
+        static LLVMContext *context = new LLVMContext();
+        return *context;
     }
 };
 inline raw_ostream &operator<<(raw_ostream &out,
@@ -75,7 +318,9 @@ inline raw_ostream &operator<<(raw_ostream &out,
         if (iter != setOfValues.begin()) {
             out << ", ";
         }
-        if ((*iter)->hasName()) {
+        if (PointToInfo::isTop(*iter)) {
+            out << "<top>";
+        } else if ((*iter)->hasName()) {
             if (isa<Function>(*iter)) {
                 out << "@" << (*iter)->getName();
             } else {
@@ -88,6 +333,10 @@ inline raw_ostream &operator<<(raw_ostream &out,
     out << "}";
     return out;
 }
+inline size_t heapBytes(const PointToInfo &info) {
+    return info.pointToSetBytes() + info.bindingBytes() + info.otherBytes();
+}
+
 inline raw_ostream &operator<<(raw_ostream &out, const PointToInfo &info) {
     out << "Point-to sets: \n";
     for (const auto& v : info.pointToSets) {
@@ -113,71 +362,245 @@ inline raw_ostream &operator<<(raw_ostream &out, const PointToInfo &info) {
     return out;
 }
 
+/// 被调函数的 mod/ref 摘要，每个函数只算一次。
+/// 调用者能看到的变化只会经过指针参数和指针返回值传回来（见 handleCallInst 里的 argPairs），
+/// 所以没有指针参数、不返回指针、内部调用也都满足这一点的函数不会改变调用者的 PointToInfo，
+/// 分析它唯一的作用就是记录它内部的调用结果，这些结果在这里直接预先算好。
+struct CalleeSummary {
+    bool modRef = true;                                   // 是否可能改写或返回调用者可见的指针
+    std::vector<std::pair<unsigned, std::string>> calls;  // 跳过分析时需要补记的 行号 : 被调函数
+};
+
+/// 预先解码好的一条指令，见 PointToVisitor::lowerInstruction。
+/// 只有会改变 PointToInfo 的指令才会被降低，操作数在降低时就取好了，
+/// 求不动点时每次访问基本块直接按数组执行，不再逐条指令 dyn_cast、取操作数、判断类型。
+struct LoweredOp {
+    enum Kind : uint8_t { Store, Load, GEP, MemCpy, Call, Ret };
+    Kind kind;
+    Instruction *inst;
+    Value *result;   // load / GEP 的结果，ret 所在的函数
+    Value *pointer;  // store / load / GEP 的指针，memcpy 的目的地址
+    Value *value;    // store 存进去的值，memcpy 的源地址，ret 的返回值（可能为空）
+};
+
+inline size_t heapBytes(const CalleeSummary &summary) {
+    return heapBytes(summary.calls);
+}
+
+inline size_t heapBytes(const LoweredOp &) {
+    return 0;
+}
+
+static_assert(LoweredOp::Ret + 1 == AnalysisStats::NumHandlers, "AnalysisStats::handlerName follows LoweredOp::Kind");
+
 class PointToVisitor : public DataflowVisitor<struct PointToInfo> {
 public:
     // 存放函数调用结果，输出模式为行号：函数名
     std::map<unsigned , std::set<std::string>> results;
 
+    // 每个函数的活跃变量分析结果，只算一次
+    std::map<Function *, DataflowResult<LivenessInfo>::Type> livenessResults;
+    // 不为空时从外部（新 PassManager 的 LivenessAnalysis 缓存）取活跃变量结果，不再自己算
+    std::function<const DataflowResult<LivenessInfo>::Type &(Function *)> livenessProvider;
+
+    std::map<Function *, CalleeSummary> summaries;
+
+    // 每个基本块降低后的操作序列，第一次访问时生成
+    std::map<BasicBlock *, std::vector<LoweredOp>> loweredBlocks;
+
+    // 工作量计数：基本块被求值的次数，被调函数被重新分析（不走 summary 快速路径）的次数
+    uint64_t blockVisits = 0;
+    uint64_t calleeAnalyses = 0;
+
+    // 相关性切片，为空时处理所有指令
+    const RelevanceSlice *slice = nullptr;
+
+    // 间接调用只分析类型和调用完全相同的候选函数
+    bool typeFilter = true;
+
+    // 一个集合里最多保留几个函数，超过时换成 top，0 表示不限制，见 PointToInfo::top
+    unsigned maxPointsTo = 0;
+
+    // 为查询保留分析结果（服务模式用），默认关闭，不影响命令行的输出
+    // functionStates: 每个函数每个基本块的入口/出口状态，多个调用上下文合并在一起
+    // callSiteTargets: 每个调用点解析出的被调函数
+    bool keepStates = false;
+    std::map<Function *, DataflowResult<PointToInfo>::Type> functionStates;
+    std::map<CallInst *, std::set<Function *>> callSiteTargets;
+    // 目标里有按类型补上的函数（top 展开、预算用完后退化）的调用点，这些调用点的目标不一定全是真的
+    std::set<CallInst *> approximatedCalls;
+
+    // 懒加载模式下，分析第一次走到一个函数（入口、直接调用、解析出的间接调用目标）时
+    // 用它来加载函数体，为空表示模块已经完整加载
+    std::function<void(Function *)> materialize;
+
+    // 打开统计时，递归栈上每一层正在求解的 DataflowResult，用来算同时存在的状态占多少内存
+    std::vector<const DataflowResult<PointToInfo>::Type *> activeResults;
+
+    // 资源预算，用完以后的处理见 degradeFunction
+    BudgetMonitor budget;
+    // 结果是按类型退化得到的函数和行号
+    std::set<Function *> degradedFunctions;
+    std::set<unsigned> degradedLines;
+    // 函数类型 -> 取过地址的函数，第一次退化时建立
+    std::map<FunctionType *, std::vector<Function *>> addressTakenByType;
+
+    // 正在求解（在递归栈上）的函数。再次调用到它们时不再递归分析，见 handleCallInst
+    std::set<Function *> activeFunctions;
+    // 因为递归没有分析的被调函数
+    std::set<std::string> recursiveCallees;
+    // 超过调用深度预算没有分析的被调函数
+    std::set<std::string> deepCallees;
+
     PointToVisitor() {}
 
-    // 这一部分和基础思路抄的https://github.com/ChinaNuke/Point-to-Analysis
-    void merge(PointToInfo *dest, const PointToInfo &src) override {
-        // 合并 pointToSets
-        auto &destSets = dest->pointToSets;
-        const auto &srcSets = src.pointToSets;
+    void beginSolve(Function *fn, const DataflowResult<PointToInfo>::Type *result) {
+        activeFunctions.insert(fn);
+        if (stats) activeResults.push_back(result);
+    }
+
+    /// 最深的一层求解完时栈上的状态最多，在这里采样
+    void endSolve(Function *fn) {
+        activeFunctions.erase(fn);
+        if (!stats) return;
+        size_t bindingBytes = 0, pointToSetBytes = 0, otherBytes = 0;
+        for (const DataflowResult<PointToInfo>::Type *result : activeResults) {
+            otherBytes += heapBytes(*result);
+            for (const auto &block : *result) {
+                for (const PointToInfo *info : {&block.second.first, &block.second.second}) {
+                    bindingBytes += info->bindingBytes();
+                    pointToSetBytes += info->pointToSetBytes();
+                }
+            }
+        }
+        // heapBytes(*result) 已经包含了 bindings 和 pointToSets，剩下的是 map 节点、缓存和 LiveVars
+        otherBytes -= bindingBytes + pointToSetBytes;
+        stats->recordLive(activeResults.size(), bindingBytes, pointToSetBytes, otherBytes);
+        activeResults.pop_back();
+    }
 
-        for (const auto &pts : srcSets) {
-            Value *k = pts.first;
-            const std::set<Value *> &s = pts.second;
+    /// 分析结束时常驻的各部分
+    void recordMemory() {
+        if (!stats) return;
+        stats->components = {
+            {"results", heapBytes(results)},
+            {"function states", heapBytes(functionStates)},
+            {"call-site targets", heapBytes(callSiteTargets)},
+            {"liveness", heapBytes(livenessResults)},
+            {"lowered blocks", heapBytes(loweredBlocks)},
+            {"callee summaries", heapBytes(summaries)},
+        };
+    }
 
-            auto result = destSets.find(k);
-            if (result == destSets.end()) {
-                destSets.insert(std::make_pair(k, s));
+    void recordStates(Function *fn, DataflowResult<PointToInfo>::Type &result) {
+        if (!keepStates) return;
+        auto &states = functionStates[fn];
+        for (auto &bb : result) {
+            auto it = states.find(bb.first);
+            if (it == states.end()) {
+                states.insert(bb);
             } else {
-                result->second.insert(s.begin(), s.end());
+                merge(&it->second.first, bb.second.first);
+                merge(&it->second.second, bb.second.second);
             }
         }
+    }
 
-        // 合并 bindings
-        // 一般情况下绑定信息是不需要在基本块之间传递的，但是为了能够解决引用型参数和函数返回问题，
-        // 在这里也进行合并，不影响结果，但是可能会让调试信息更杂乱。
-        auto &destBindings = dest->bindings;
-        const auto &srcBindings = src.bindings;
+    void recordCallee(CallInst *callInst, Function *callee) {
+        if (keepStates) {
+            callSiteTargets[callInst].insert(callee);
+        }
+    }
 
-        for (const auto &binding : srcBindings) {
-            Value *k = binding.first;
-            const std::set<Value *> &s = binding.second;
+    void ensureMaterialized(Function *fn) {
+        if (materialize && fn->isMaterializable()) {
+            materialize(fn);
+        }
+    }
 
-            auto result = destBindings.find(k);
-            if (result == destBindings.end()) {
-                destBindings.insert(std::make_pair(k, s));
-            } else {
-                result->second.insert(s.begin(), s.end());
+    bool budgetExhausted() override {
+        return budget.exhausted(blockVisits);
+    }
+
+    /// 类型为 type 的间接调用可能调用的函数：所有取过地址、类型完全相同的函数
+    const std::vector<Function *> &addressTakenFunctions(Module &M, FunctionType *type) {
+        if (addressTakenByType.empty()) {
+            for (Function &fn : M) {
+                // 懒加载时没加载的函数体里的取地址看不到，先全部加载
+                ensureMaterialized(&fn);
+            }
+            for (Function &fn : M) {
+                if (!fn.isIntrinsic() && fn.hasAddressTaken()) {
+                    addressTakenByType[fn.getFunctionType()].push_back(&fn);
+                }
             }
         }
+        return addressTakenByType[type];
     }
 
+    /// 预算用完或者遇到递归调用时代替不动点求解的保守结果：fn 和它能调用到的所有函数里，
+    /// 直接调用记被调函数，间接调用记所有取过地址、类型相同的函数，这些行标记为退化。
+    /// 求解中途放弃的函数，它的调用者拿到的状态也不完整，而预算一旦用完就一直是用完的，
+    /// 所以递归栈上的每一层都会放弃并走到这里，已经算出来的精确结果保留，只是再并上退化的结果。
+    void degradeFunction(Function *fn) {
+        std::vector<Function *> pending;
+        if (degradedFunctions.insert(fn).second) {
+            pending.push_back(fn);
+        }
+        while (!pending.empty()) {
+            Function *cur = pending.back();
+            pending.pop_back();
+            ensureMaterialized(cur);
+            for (BasicBlock &bb : *cur) {
+                for (Instruction &inst : bb) {
+                    CallInst *call = dyn_cast<CallInst>(&inst);
+                    if (!call || isa<DbgInfoIntrinsic>(call) || isa<MemSetInst>(call) || isa<MemCpyInst>(call)) {
+                        continue;
+                    }
+                    std::vector<Function *> callees;
+                    if (Function *callee = call->getCalledFunction()) {
+                        callees.push_back(callee);
+                    } else {
+                        callees = addressTakenFunctions(*cur->getParent(), call->getFunctionType());
+                    }
+                    unsigned line = call->getDebugLoc() ? call->getDebugLoc().getLine() : 0;
+                    degradedLines.insert(line);
+                    if (keepStates) approximatedCalls.insert(call);
+                    std::set<std::string> &lineResult = results[line];
+                    for (Function *callee : callees) {
+                        lineResult.insert(callee->getName().str());
+                        recordCallee(call, callee);
+                        if (!callee->isDeclaration() && degradedFunctions.insert(callee).second) {
+                            pending.push_back(callee);
+                        }
+                    }
+                }
+            }
+        }
+    }
 
-    void handleAllocaInst(AllocaInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("Alloca Inst!" << *pInst);
+    // 这一部分和基础思路抄的https://github.com/ChinaNuke/Point-to-Analysis
+    void merge(PointToInfo *dest, const PointToInfo &src) override {
+        // 合并 pointToSets
+        for (const auto &pts : src.pointToSets) {
+            dest->addPointToSet(pts.first, pts.second, maxPointsTo);
+        }
+
+        // 合并 bindings
+        // 一般情况下绑定信息是不需要在基本块之间传递的，但是为了能够解决引用型参数和函数返回问题，
+        // 在这里也进行合并，不影响结果，但是可能会让调试信息更杂乱。
+        for (const auto &binding : src.bindings) {
+            dest->addBinding(binding.first, binding.second, maxPointsTo);
+        }
     }
 
+
     /// DEBUG test00 进入comp嵌套后，第三次storeInst结果出错：
     /// 正常：%a_fptr.addr: {@plus}
     /// 当前：%a_fptr.addr: {%a_fptr}
     /// 错因：pInfo->hasBinding(value)里的参数一定是value，而不是pointer，因为是store的源操作数有binding才需要考虑
-    void handleStoreInst(StoreInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("Store Inst!" << *pInst);
-        Value *value = pInst->getValueOperand();
-        Value *pointer = pInst->getPointerOperand();
-
-        // 忽略常量数据
-        // https://llvm.org/doxygen/classllvm_1_1Constant.html
-        if (isa<ConstantData>(value)) {
-            //LOG_DEBUG("Skipped constant data " << *value << " in StoreInst.");
-            return;
-        }
-
+    /// 存常量数据（https://llvm.org/doxygen/classllvm_1_1Constant.html）的 store 在 lowerInstruction 里就忽略了
+    void handleStoreInst(Value *value, Value *pointer, PointToInfo *pInfo) {
         // 如果有别名，那么把别名的值也给加入到 PTS 里。
         // 注意这里 key 是 pointer，value 是 value
         /// *IMPORTANT* 这里的hasBinding的key一定是pointer
@@ -189,89 +612,83 @@ public:
 //        }
 
         // test02 需要处理一个指针多个binding的情况。
-        std::set<Value *> processSet = {pointer};
-        std::set<Value *> pointToSetTargets;
-        while(processSet.size() > 0){
-            Value *curPointer = *(processSet.begin());
-            processSet.erase(curPointer);
-            // 如果当前处理的指针有绑定，那么用绑定的值替换实际的值，没有绑定就把当前的这个加入到PTS待处理队列
-            if(pInfo->hasBinding(curPointer)){
-                processSet.insert(pInfo->bindings[curPointer].begin(), pInfo->bindings[curPointer].end());
-            } else {
-                pointToSetTargets.insert(curPointer);
-            }
-        }
+        // binding 链的传递解析交给 resolveBinding，带缓存且能处理环
+        const std::set<Value *> &pointToSetTargets = pInfo->resolveBinding(pointer);
 
-        // 同上，开始处理value，看看value有没有binding
-        std::set<Value *> values;
-        if (pInfo->hasBinding(value)) {
-            values = pInfo->getBinding(value);
-        } else {
-            values.insert(value);
-        }
+        // 开始处理value，看看value有没有binding，这里只看一层
+        std::set<Value *> values = pInfo->getBindingOrSelf(value);
 
         // 开始处理 pointToSetTargets，更新 pointToSets
         if (pointToSetTargets.size() == 1) {
-            pInfo->pointToSets[*pointToSetTargets.begin()] = values;
+            pInfo->setPointToSet(*pointToSetTargets.begin(), values, maxPointsTo);
         } else {
             for (Value *target : pointToSetTargets) {
-                std::set<Value *> oldPTS = pInfo->pointToSets[target];
-                oldPTS.insert(values.begin(), values.end());
-                pInfo->pointToSets[target] = oldPTS;
+                pInfo->addPointToSet(target, values, maxPointsTo);
             }
         }
     }
 
-    void handleLoadInst(LoadInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("Load Inst!" << *pInst);
-        // 获取 value 以及 pointer
-        Value *pointer = pInst->getPointerOperand();
-        Value *result = dyn_cast<Value>(pInst);
-
-        // 只处理二级指针及以上，因为一级指针总是指向常数
-        // https://stackoverflow.com/a/12954400/15851567
-        if (!pointer->getType()->getContainedType(0)->isPointerTy()) {
-            return;
-        }
-
+    /// 一级指针的 load 在 lowerInstruction 里就忽略了
+    void handleLoadInst(Value *result, Value *pointer, PointToInfo *pInfo) {
         // 获取binding， binding 的值是 pointToSets里的值
+        // pointer 没有绑定时就是它自身，等价于直接取 getPTS
         std::set<Value *> bindings;
-        if (pInfo->hasBinding(pointer)) {
-            // 如果pointer有绑定，获取所有绑定的目标
-            std::set<Value *> boundTargets = pInfo->getBinding(pointer);
-            for (Value *boundTarget : boundTargets) {
-                // 对每个绑定的目标，获取其点对集并合并
-                std::set<Value *> boundPTS = pInfo->pointToSets[boundTarget];
-                bindings.insert(boundPTS.begin(), boundPTS.end());
-            }
-        } else {
-            // 如果没有绑定，直接使用原先的getPTS
-            bindings = pInfo->pointToSets[pointer];
+        for (Value *boundTarget : pInfo->getBindingOrSelf(pointer)) {
+            // 对每个绑定的目标，获取其点对集并合并
+            const std::set<Value *> &boundPTS = pInfo->touchPointToSet(boundTarget);
+            bindings.insert(boundPTS.begin(), boundPTS.end());
         }
 
-        pInfo->setBinding(result, bindings);
-        LOG_DEBUG("Load Inst Get Result!" << *pInst << " result: " << *result << " binding: " << pInfo->bindings[result]);
+        pInfo->setBinding(result, bindings, maxPointsTo);
+        LOG_DEBUG("Load Inst Get Result! result: " << *result << " binding: " << pInfo->getBinding(result));
     }
 
     /// DEBUG test02 GEPInst，
     /// getelementptr 指令用于计算复合数据类型（如结构体或数组）内部元素的地址。
     /// 也是处理binding 就行
-    void handleGEPInst(GetElementPtrInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("GetElementPtr Inst!" << *pInst);
-
-        Value *ptrval = pInst->getPointerOperand();
-        Value *result = dyn_cast<Value>(pInst);
-
-        if (pInfo->hasBinding(ptrval)) {
-            pInfo->setBinding(result, pInfo->getBinding(ptrval));
-        } else {
-            pInfo->setBinding(result, {ptrval});
-        }
+    void handleGEPInst(Value *result, Value *ptrval, PointToInfo *pInfo) {
+        pInfo->setBinding(result, pInfo->getBindingOrSelf(ptrval), maxPointsTo);
     }
 
-
-    void handleCastInst(CastInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("Cast Inst!" << *pInst);
+    const CalleeSummary &getSummary(Function *fn) {
+        auto it = summaries.find(fn);
+        if (it != summaries.end()) {
+            return it->second;
+        }
+        // 先放一个 modRef 的占位，递归调用自己的函数就不会走快速路径
+        summaries[fn] = CalleeSummary();
+        ensureMaterialized(fn);
+
+        CalleeSummary summary;
+        summary.modRef = fn->isDeclaration() || fn->getReturnType()->isPointerTy();
+        for (Argument &arg : fn->args()) {
+            summary.modRef |= arg.getType()->isPointerTy();
+        }
+        for (BasicBlock &bb : *fn) {
+            for (Instruction &inst : bb) {
+                if (summary.modRef) break;
+                CallInst *call = dyn_cast<CallInst>(&inst);
+                // 这几种 compDFVal 不当作函数调用处理
+                if (!call || isa<DbgInfoIntrinsic>(call) || isa<MemSetInst>(call) || isa<MemCpyInst>(call)) {
+                    continue;
+                }
+                Function *callee = call->getCalledFunction();
+                unsigned line = call->getDebugLoc() ? call->getDebugLoc().getLine() : 0;
+                if (callee && callee->getName() == "malloc") {
+                    summary.calls.push_back(std::make_pair(line, std::string("malloc")));
+                } else if (callee && !getSummary(callee).modRef) {
+                    const CalleeSummary &sub = getSummary(callee);
+                    summary.calls.push_back(std::make_pair(line, callee->getName().str()));
+                    summary.calls.insert(summary.calls.end(), sub.calls.begin(), sub.calls.end());
+                } else {
+                    summary.modRef = true;
+                }
+            }
+        }
+        if (summary.modRef) {
+            summary.calls.clear();
+        }
+        return summaries[fn] = std::move(summary);
     }
 
     // 由于程序传入的只有 main 函数，所以需要在 call 里面执行具体的函数分析
@@ -296,10 +713,15 @@ public:
         //LOG_DEBUG("Call Inst!" << *callInst);
         Value *operand = callInst->getCalledOperand();
         std::set<std::string>& curLineResult = results[callInst->getDebugLoc().getLine()];
+        // 进入调用时立刻检查一次时间和内存：一次调用下面可能是很深的调用链，
+        // 只靠基本块循环里每 CheckInterval 次采样一次，用完以后可能还要分析很久才发现
+        budget.exhausted(blockVisits, true);
 
         // 对malloc函数调用做特殊处理
         if (isa<Function>(operand) && operand->getName() == "malloc") {
+            if (stats) stats->mallocCalls++;
             curLineResult.insert(operand->getName());
+            recordCallee(callInst, cast<Function>(operand));
             return;
         }
 
@@ -310,7 +732,35 @@ public:
         if(isa<Function>(operand)){
             funcQueue.insert(operand);
         } else {
-            funcQueue.insert(pInfo->bindings[operand].begin(), pInfo->bindings[operand].end());
+            if (pInfo->hasBinding(operand)) {
+                funcQueue = pInfo->getBinding(operand);
+            }
+            // 类型对不上的候选（经过强制转换存进来的函数、和函数存在同一块内存里的其他值）
+            // 不可能是这次调用的目标，不分析，它们的状态也不会合并进来。
+            // 和 addressTakenFunctions 里同类型的函数取交集是一回事：binding 里出现的函数都是取过地址的，
+            // 所以直接比较类型，懒加载时也不用为了建索引加载所有函数
+            if (typeFilter) {
+                FunctionType *callType = callInst->getFunctionType();
+                for (auto it = funcQueue.begin(); it != funcQueue.end();) {
+                    Function *candidate = dyn_cast<Function>(*it);
+                    if (!PointToInfo::isTop(*it) && (!candidate || candidate->getFunctionType() != callType)) {
+                        it = funcQueue.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            // 折叠成 top 的集合按调用的函数类型展开；degradedTop 来自没有分析的调用，这一行标记为退化
+            if (funcQueue.erase(PointToInfo::degradedTop())) {
+                degradedLines.insert(callInst->getDebugLoc().getLine());
+                funcQueue.insert(PointToInfo::top());
+            }
+            if (funcQueue.erase(PointToInfo::top())) {
+                if (keepStates) approximatedCalls.insert(callInst);
+                const std::vector<Function *> &matching =
+                        addressTakenFunctions(*callInst->getModule(), callInst->getFunctionType());
+                funcQueue.insert(matching.begin(), matching.end());
+            }
         }
 
 
@@ -320,6 +770,22 @@ public:
          std::set<Value*> isRepeat;
          for(auto* funcVal : funcQueue) {
             Function* func = dyn_cast<Function>(funcVal);
+            if (!func) {
+                continue;
+            }
+
+            // 快速路径：plus、minus 这种不会改写或返回指针的函数，只记录结果，不做分析。
+            // 为查询保留状态时不走：走快速路径的函数没有 functionStates，它里面的调用也没有 callSiteTargets
+            const CalleeSummary &summary = getSummary(func);
+            if (!keepStates && !summary.modRef) {
+                if (stats) stats->functions[func].summaryHits++;
+                curLineResult.insert(func->getName().str());
+                recordCallee(callInst, func);
+                for (const auto &call : summary.calls) {
+                    results[call.first].insert(call.second);
+                }
+                continue;
+            }
 
             /// 函数调用准备变量
             // 目标函数入口&出口BB
@@ -335,6 +801,24 @@ public:
 
             //  存入结果集
             curLineResult.insert(func->getName());
+            recordCallee(callInst, func);
+            if (budgetExhausted()) {
+                havocCall(callInst, func, pInfo);
+                continue;
+            }
+            // 递归调用：被调函数已经在求解栈上，再分析一遍只会无限递归下去。
+            // 和预算用完一样按类型退化，见 havocCall
+            if (activeFunctions.count(func)) {
+                recursiveCallees.insert(func->getName().str());
+                havocCall(callInst, func, pInfo);
+                continue;
+            }
+            // 调用深度预算：栈上除了递归的情况每个函数只出现一次，activeFunctions 的大小就是被调函数的深度
+            if (budget.tooDeep(activeFunctions.size())) {
+                deepCallees.insert(func->getName().str());
+                havocCall(callInst, func, pInfo);
+                continue;
+            }
 
             // TODO:处理函数参数，先不考虑
             for (unsigned i = 0, num = callInst->getNumArgOperands(); i < num; i++) {
@@ -349,29 +833,28 @@ public:
                 /// 开始处理函数调用前后传递的参数映射
                 // 传入的是指针参数，这里的指针参数代表的其实是binding，比如值传递
                 argPairs.insert(std::make_pair(callerArg, calleeArg));
-                // 如果这个参数传递前已有binding，则直接拿来用
+                // 如果这个参数传递前已有binding，则直接拿来用，没有 binding 就把被传的变量作为binding
                 // 注意是传递前，所以是 callerArg
-                std::set<Value *> curCalleeBinding;
-                if (pInfo->hasBinding(callerArg)) {
-                    curCalleeBinding = pInfo->getBinding(callerArg);
-                    ////LOG_DEBUG("CalleeArg Has Binding!" << curCalleeBinding);
-                } else { // 如果没有 binding，就把被传的变量作为binding
-                    curCalleeBinding = {callerArg};
-                    //LOG_DEBUG("CallerArg Binding" << *callerArg);
-                }
-                calleeArgBindings.setBinding(calleeArg, curCalleeBinding);
+                std::set<Value *> curCalleeBinding = pInfo->getBindingOrSelf(callerArg);
+                calleeArgBindings.setBinding(calleeArg, curCalleeBinding, maxPointsTo);
                 // 开始处理各个binding的pointToSet，方便过一会递归调用的初始状态
-                while (!curCalleeBinding.empty()) {
-                    Value *curBinding = *curCalleeBinding.begin();
-                    curCalleeBinding.erase(curCalleeBinding.begin());
-                    // //LOG_DEBUG("Finding dependency for " << *v);
+                // 指向关系可能成环（比如结构体里存了自己的地址），用 visited 保证每个值只处理一次
+                std::set<Value *> visited(curCalleeBinding);
+                std::vector<Value *> pending(curCalleeBinding.begin(), curCalleeBinding.end());
+                while (!pending.empty()) {
+                    Value *curBinding = pending.back();
+                    pending.pop_back();
                     if (pInfo->hasPointToSet(curBinding)) {
                         std::set<Value *> curPointToSet = pInfo->getPointToSet(curBinding);
                         //LOG_DEBUG("Dependencies found: " << curPointToSet);
-                        calleeArgBindings.setPointToSet(curBinding, curPointToSet);
+                        calleeArgBindings.setPointToSet(curBinding, curPointToSet, maxPointsTo);
                         argPairs.insert(std::make_pair(curBinding, curBinding));
                         // 为处理列表里添加新的需要处理的元素
-                        curCalleeBinding.insert(curPointToSet.begin(), curPointToSet.end());
+                        for (Value *next : curPointToSet) {
+                            if (visited.insert(next).second) {
+                                pending.push_back(next);
+                            }
+                        }
                     }
                 }
             }
@@ -381,7 +864,7 @@ public:
                 // 这里需要特殊处理一下 initval，因为递归调用的时候已经是有状态的了
                 // 直接调用无法保留状态
                 //LOG_DEBUG("Function " << func->getName() << " has a pointer return type.");
-                calleeArgBindings.setBinding(func, {func});
+                calleeArgBindings.setBinding(func, {func}, maxPointsTo);
                 argPairs.insert(std::make_pair(dyn_cast<Value>(callInst), func));
             }
 
@@ -393,7 +876,23 @@ public:
             // 处理被 call 的函数，直接使用 compForwardDataflow 来处理
             result[targetEntry].first = calleeArgBindings; // incomings of target entry
             //LOG_DEBUG("---------------------------------- Now recursively handling function: " << func->getName() << "----------------------------------");
-            compForwardDataflow(func, this, &result, initval);
+            calleeAnalyses++;
+            if (stats) stats->functions[func].calleeAnalyses++;
+            {
+                beginSolve(func, &result);
+                TraceScope callSpan(trace, "call", func->getName());
+                if (callSpan.enabled()) {
+                    callSpan.arg("line", (int64_t)callInst->getDebugLoc().getLine());
+                    callSpan.arg("caller", callInst->getFunction()->getName().str());
+                    callSpan.arg("in", (int64_t)calleeArgBindings.entryCount());
+                }
+                if (!compForwardDataflow(func, this, &result, initval)) {
+                    degradeFunction(func);
+                }
+                callSpan.arg("out", (int64_t)result[targetExit].second.entryCount());
+                endSolve(func);
+            }
+            recordStates(func, result);
             PointToInfo &calleeOutBindings = result[targetExit].second; // outcomings of target exit
 
             LOG_DEBUG("处理完毕函数 " << func->getName() << "，前的PTS \n" << *pInfo);
@@ -407,22 +906,27 @@ public:
                         for(auto* each : outBinding)
                             curBinding.insert(each);
                         LOG_DEBUG("CurBinding " << curBinding);
-                        pInfo->setBinding(pair.first, curBinding);
+                        pInfo->setBinding(pair.first, curBinding, maxPointsTo);
                     } else {
-                        pInfo->setBinding(pair.first, outBinding);
+                        pInfo->setBinding(pair.first, outBinding, maxPointsTo);
                     }
                     LOG_DEBUG("处理函数 " << func->getName() << "后，" << *pair.first << "的binding变化后," << pInfo->getBinding(pair.first));
                 }
 
-                std::set<Value *> queue = {pair.second};
+                std::set<Value *> visited = {pair.second};
+                std::vector<Value *> queue = {pair.second};
                 while (!queue.empty()) {
-                    Value *v = *queue.begin();
-                    queue.erase(v);
+                    Value *v = queue.back();
+                    queue.pop_back();
 
                     if (calleeOutBindings.hasPointToSet(v)) {
                         std::set<Value *> s = calleeOutBindings.getPointToSet(v);
-                        pInfo->setPointToSet(v, s);
-                        queue.insert(s.begin(), s.end());
+                        pInfo->setPointToSet(v, s, maxPointsTo);
+                        for (Value *next : s) {
+                            if (visited.insert(next).second) {
+                                queue.push_back(next);
+                            }
+                        }
                     }
                 }
             }
@@ -431,81 +935,222 @@ public:
     }
 
 
-    void handleReturnInst(ReturnInst* returnInst, PointToInfo *pInfo) {
-        Value *value = returnInst->getReturnValue();
-        Value *func = returnInst->getFunction();
-
-        //LOG_DEBUG("Return Inst ! " << *returnInst);
+    /// 不分析 func 时这次调用的保守结果：func 和它调用的函数按类型退化（degradeFunction），
+    /// 调用者这边 func 能改到的东西，也就是指针参数能到达的每个内存对象的指向集合和返回值，都并上 degradedTop，
+    /// 其中原来的函数折叠掉。之后从这些地方读出函数指针再调用的行按类型展开并标记为退化。
+    /// 只用并集不做强更新，原来的内存对象保留。
+    void havocCall(CallInst *callInst, Function *func, PointToInfo *pInfo) {
+        degradeFunction(func);
+        std::set<Value *> visited;
+        std::vector<Value *> pending;
+        for (unsigned i = 0, num = callInst->getNumArgOperands(); i < num; i++) {
+            Value *callerArg = callInst->getArgOperand(i);
+            if (!callerArg->getType()->isPointerTy()) continue;
+            for (Value *target : pInfo->getBindingOrSelf(callerArg)) {
+                if (visited.insert(target).second) pending.push_back(target);
+            }
+        }
+        while (!pending.empty()) {
+            Value *object = pending.back();
+            pending.pop_back();
+            if (isa<Function>(object) || PointToInfo::isTop(object)) continue;
+            for (Value *next : pInfo->getPointToSet(object)) {
+                if (visited.insert(next).second) pending.push_back(next);
+            }
+            pInfo->addPointToSet(object, {PointToInfo::degradedTop()}, maxPointsTo);
+        }
+        if (func->getReturnType()->isPointerTy()) {
+            pInfo->setBinding(callInst, {PointToInfo::degradedTop()}, maxPointsTo);
+        }
+    }
 
+    void handleReturnInst(Value *func, Value *value, PointToInfo *pInfo) {
         if (pInfo->hasBinding(func)) {
             // 把返回值直接绑定到所在函数上
-            if (pInfo->hasBinding(value)) {
-                pInfo->setBinding(func, pInfo->getBinding(value));
-            } else {
-                pInfo->setBinding(func, {value});
-            }
+            pInfo->setBinding(func, pInfo->getBindingOrSelf(value), maxPointsTo);
         }
     }
 
-    void handlePHINode(PHINode *pNode, PointToInfo *pInfo) {
-        //LOG_DEBUG("handle PHINode!" << *pNode);
+    // MemcpyInst 就是复制一个指针的内存到另外一个，考虑直接复制PTS，binding应该不用
+    void handleMemcpyInst(Value *right, Value *left, PointToInfo *pInfo) {
+        // 复制PTS
+        pInfo->setPointToSet(right, pInfo->touchPointToSet(left), maxPointsTo);
     }
 
-    void handleSelectInst(SelectInst *pInst, PointToInfo *pInfo) {
-        //LOG_DEBUG("handle select!" << *pInst);
-
+    const DataflowResult<LivenessInfo>::Type &getLiveness(Function *fn) {
+        if (livenessProvider) {
+            return livenessProvider(fn);
+        }
+        auto it = livenessResults.find(fn);
+        if (it == livenessResults.end()) {
+            LivenessVisitor visitor;
+            visitor.stats = stats;
+            LivenessInfo initval;
+            it = livenessResults.insert(std::make_pair(fn, DataflowResult<LivenessInfo>::Type())).first;
+            compBackwardDataflow(fn, &visitor, &it->second, initval);
+        }
+        return it->second;
     }
 
-    // MemcpyInst 就是复制一个指针的内存到另外一个，考虑直接复制PTS，binding应该不用
-    void handleMemcpyInst(MemCpyInst *pInst, PointToInfo *pInfo) {
-        auto* left = pInst->getSource();
-        auto* right = pInst->getDest();
+    /// 删掉本函数里在块出口已经死掉、并且不会再通过其他 binding 或 PTS 间接查到的临时变量 binding。
+    /// 其他函数的值（比如调用者传进来的参数对应的 binding）以及 Argument、Function 上的 binding 都保留。
+    /// 只在出口状态要流进汇合点（有多个前驱的后继）或者函数出口时裁剪：直线上的基本块之间状态原样往下传，
+    /// 多带几个死 binding 不影响结果，到合并之前再一起删，不用每访问一个基本块都扫一遍整个状态。
+    void pruneDeadBindings(BasicBlock *block, PointToInfo *pInfo) {
+        if (!flowsIntoJoin(block)) return;
+        Function *fn = block->getParent();
+        const auto &liveness = getLiveness(fn);
+        auto live = liveness.find(block);
+        if (live == liveness.end()) return;
+        pInfo->LiveVars = live->second.second.LiveVars;
+
+        std::vector<Value *> dead;
+        for (const auto &binding : pInfo->bindings) {
+            Instruction *inst = dyn_cast<Instruction>(binding.first);
+            if (inst && inst->getFunction() == fn && !pInfo->LiveVars.count(inst)) {
+                dead.push_back(inst);
+            }
+        }
+        if (dead.empty()) return;
 
-        // 复制PTS
-        pInfo->pointToSets[right] = pInfo->pointToSets[left];
+        // 还能被间接查到的值：出现在任何 binding 或 PTS 的集合里，有候选时才需要收集
+        std::set<Value *> referenced;
+        for (const auto &binding : pInfo->bindings) {
+            referenced.insert(binding.second.begin(), binding.second.end());
+        }
+        for (const auto &pts : pInfo->pointToSets) {
+            referenced.insert(pts.second.begin(), pts.second.end());
+        }
+        for (Value *val : dead) {
+            if (!referenced.count(val)) {
+                pInfo->eraseBinding(val);
+            }
+        }
     }
 
-    void compDFVal(Instruction *inst, PointToInfo * pInfo) override{
-        LOG_DEBUG("Current Instruction: " << *inst);
-
-        // 不处理 LLVM 指令
-        if (isa<DbgInfoIntrinsic>(inst)) return;
+    static bool flowsIntoJoin(BasicBlock *block) {
+        bool exit = true;
+        for (BasicBlock *succ : successors(block)) {
+            exit = false;
+            if (!succ->getSinglePredecessor()) return true;
+        }
+        return exit;
+    }
 
-        if (AllocaInst *allocaInst = dyn_cast<AllocaInst>(inst)) {
-            // 处理Alloca指令，没什么用，只声明不赋值
-            handleAllocaInst(allocaInst, pInfo);
-        } else if (StoreInst *storeInst = dyn_cast<StoreInst>(inst)) {
-            // 处理Store指令
-            handleStoreInst(storeInst, pInfo);
+    /// 把一条指令降低成 LoweredOp，不影响 PointToInfo 的指令返回 false：
+    /// alloca（只声明不赋值）、cast、phi、select、memset、调试 intrinsic、切片外的 store / load / GEP，
+    /// 存常量数据的 store，以及一级指针的 load（一级指针总是指向常数，https://stackoverflow.com/a/12954400/15851567）
+    bool lowerInstruction(Instruction *inst, LoweredOp &op) const {
+        if (isa<DbgInfoIntrinsic>(inst)) return false;
+        // 和函数指针无关的 store / load / GEP 直接跳过
+        if (slice && !slice->isRelevant(inst)) return false;
+
+        op.inst = inst;
+        op.result = op.pointer = op.value = nullptr;
+        if (StoreInst *storeInst = dyn_cast<StoreInst>(inst)) {
+            if (isa<ConstantData>(storeInst->getValueOperand())) return false;
+            op.kind = LoweredOp::Store;
+            op.pointer = storeInst->getPointerOperand();
+            op.value = storeInst->getValueOperand();
         } else if (LoadInst *loadInst = dyn_cast<LoadInst>(inst)) {
-            // 处理Load指令
-            handleLoadInst(loadInst, pInfo);
+            if (!loadInst->getPointerOperand()->getType()->getContainedType(0)->isPointerTy()) return false;
+            op.kind = LoweredOp::Load;
+            op.result = loadInst;
+            op.pointer = loadInst->getPointerOperand();
         } else if (GetElementPtrInst *gepInst = dyn_cast<GetElementPtrInst>(inst)) {
-            // 处理GetElementPtr指令
-            handleGEPInst(gepInst, pInfo);
-        } else if (CastInst *castInst = dyn_cast<CastInst>(inst)) {
-            // 处理Cast指令
-            handleCastInst(castInst, pInfo);
-        } else if (MemSetInst *memSetInst = dyn_cast<MemSetInst>(inst)) {
+            op.kind = LoweredOp::GEP;
+            op.result = gepInst;
+            op.pointer = gepInst->getPointerOperand();
+        } else if (isa<MemSetInst>(inst)) {
             // 捕获但不需要处理，防止它被后面CallInst的处理逻辑捕获
             // 比如这样的：call void @llvm.memset.p0i8.i64(i8* align 8 %0, i8 0, i64 8, i1 false), !dbg !26
-        } else if (MemCpyInst* memCpyInst = dyn_cast<MemCpyInst>(inst)){
-            handleMemcpyInst(memCpyInst, pInfo);
-        }else if (CallInst *callInst = dyn_cast<CallInst>(inst)) {
-            // 处理函数调用
-            handleCallInst(callInst, pInfo);
-        } else if (PHINode *phiNode = dyn_cast<PHINode>(inst)) {
-            // 处理PHI节点
-            handlePHINode(phiNode, pInfo);
-        } else if (SelectInst *selectInst = dyn_cast<SelectInst>(inst)) {
-            // 处理Select指令
-            handleSelectInst(selectInst, pInfo);
+            return false;
+        } else if (MemCpyInst *memCpyInst = dyn_cast<MemCpyInst>(inst)) {
+            op.kind = LoweredOp::MemCpy;
+            op.pointer = memCpyInst->getDest();
+            op.value = memCpyInst->getSource();
+        } else if (isa<CallInst>(inst)) {
+            op.kind = LoweredOp::Call;
         } else if (ReturnInst *returnInst = dyn_cast<ReturnInst>(inst)) {
-            handleReturnInst(returnInst, pInfo);
+            op.kind = LoweredOp::Ret;
+            op.result = returnInst->getFunction();
+            op.value = returnInst->getReturnValue();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const std::vector<LoweredOp> &getLoweredBlock(BasicBlock *block) {
+        auto it = loweredBlocks.find(block);
+        if (it != loweredBlocks.end()) {
+            return it->second;
+        }
+        std::vector<LoweredOp> &ops = loweredBlocks[block];
+        LoweredOp op;
+        for (Instruction &inst : *block) {
+            if (lowerInstruction(&inst, op)) ops.push_back(op);
+        }
+        return ops;
+    }
+
+    void execute(const LoweredOp &op, PointToInfo *pInfo) {
+        if (stats) {
+            AnalysisStats::HandlerTimer timer(*stats, op.kind);
+            dispatch(op, pInfo);
+        } else {
+            dispatch(op, pInfo);
+        }
+    }
+
+    void dispatch(const LoweredOp &op, PointToInfo *pInfo) {
+        LOG_DEBUG("Current Instruction: " << *op.inst);
+        switch (op.kind) {
+        case LoweredOp::Store:
+            handleStoreInst(op.value, op.pointer, pInfo);
+            break;
+        case LoweredOp::Load:
+            handleLoadInst(op.result, op.pointer, pInfo);
+            break;
+        case LoweredOp::GEP:
+            handleGEPInst(op.result, op.pointer, pInfo);
+            break;
+        case LoweredOp::MemCpy:
+            handleMemcpyInst(op.pointer, op.value, pInfo);
+            break;
+        case LoweredOp::Call:
+            // 处理函数调用
+            handleCallInst(cast<CallInst>(op.inst), pInfo);
+            break;
+        case LoweredOp::Ret:
+            handleReturnInst(op.result, op.value, pInfo);
+            break;
+        }
+    }
+
+    /// 前向分析时按降低后的操作序列执行，不再走一遍 LLVM 指令
+    void compDFVal(BasicBlock *block, PointToInfo *pInfo, bool isforward) override {
+        blockVisits++;
+        if (isforward) {
+            for (const LoweredOp &op : getLoweredBlock(block)) {
+                execute(op, pInfo);
+            }
         } else {
-                //LOG_DEBUG("handle UNKNOWN instruction!" << *inst);
+            DataflowVisitor<PointToInfo>::compDFVal(block, pInfo, isforward);
         }
+        pruneDeadBindings(block, pInfo);
+        if (stats) {
+            stats->recordState(block->getParent(), pInfo->pointToSets.size() + pInfo->bindings.size(),
+                               pInfo->entryCount());
+        }
+    }
 
+    /// 单条指令（FuncPtrAnalysis 查询时重放用），降低规则和基本块一样
+    void compDFVal(Instruction *inst, PointToInfo * pInfo) override{
+        LoweredOp op;
+        if (lowerInstruction(inst, op)) {
+            execute(op, pInfo);
+        }
     }
 
     // 打印函数调用结果，输出模式为 'unsigned: string, string'，结果从 results 里面取
@@ -525,9 +1170,34 @@ public:
                         ostream << ", ";
                     ostream << *it;
                 }
+                if (degradedLines.count(key)) {
+                    ostream << " [degraded]";
+                }
                 ostream << "\n";
             }
         }
+        if (!budget.getReason().empty()) {
+            ostream << "note: " << budget.getReason() << " exhausted, lines marked [degraded] list every "
+                    << "address-taken function of a matching type\n";
+        }
+        if (!recursiveCallees.empty()) {
+            ostream << "note: recursive calls to ";
+            for (auto it = recursiveCallees.begin(); it != recursiveCallees.end(); ++it) {
+                if (it != recursiveCallees.begin()) ostream << ", ";
+                ostream << *it;
+            }
+            ostream << " were not re-analysed, lines marked [degraded] list every "
+                    << "address-taken function of a matching type\n";
+        }
+        if (!deepCallees.empty()) {
+            ostream << "note: call depth budget of " << budget.callDepth() << " reached, calls to ";
+            for (auto it = deepCallees.begin(); it != deepCallees.end(); ++it) {
+                if (it != deepCallees.begin()) ostream << ", ";
+                ostream << *it;
+            }
+            ostream << " were not analysed, lines marked [degraded] list every "
+                    << "address-taken function of a matching type\n";
+        }
     }
 
 };
@@ -0,0 +1,136 @@
+#ifndef ASSIGN3_RELEVANCE_H
+#define ASSIGN3_RELEVANCE_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include <set>
+#include <vector>
+using namespace llvm;
+
+/// 相关性切片：在正式的指向分析之前，从所有间接调用的被调用操作数出发，
+/// 沿 def-use 关系和类型信息往回走，标记出可能影响被调用函数指针的 Value 和内存位置。
+/// PointToVisitor 只处理和这些值有关的 store / load / GEP，整数缓冲区、字符串之类的都直接跳过。
+///
+/// 规则：
+/// 1. 类型里（穿过指针、结构体、数组）含有函数指针的值一定相关，保证经过别名写入的函数指针不会漏掉；
+/// 2. 间接调用的被调用操作数相关；
+/// 3. 相关值往回走：load / GEP / cast 的指针操作数，phi / select 的入边，
+///    形参对应的所有实参，直接调用的返回值对应被调函数里的 ret 值；
+/// 4. 相关的内存位置：所有以它为地址的 store 存进去的值，以它为目的地址的 memcpy 的源地址。
+class RelevanceSlice {
+public:
+    explicit RelevanceSlice(Module &M) {
+        for (Function &F : M) {
+            for (Argument &arg : F.args()) {
+                if (carriesFuncPtr(arg.getType())) mark(&arg);
+            }
+            for (BasicBlock &BB : F) {
+                for (Instruction &I : BB) {
+                    if (carriesFuncPtr(I.getType())) mark(&I);
+                    if (CallInst *call = dyn_cast<CallInst>(&I)) {
+                        if (!isa<Function>(call->getCalledOperand()->stripPointerCasts())) {
+                            mark(call->getCalledOperand());
+                        }
+                    }
+                }
+            }
+        }
+
+        while (!worklist.empty()) {
+            Value *val = worklist.back();
+            worklist.pop_back();
+            propagate(val);
+        }
+    }
+
+    bool isRelevantValue(const Value *val) const {
+        return relevant.count(val) != 0;
+    }
+
+    /// store / load / GEP 只要有一个指针相关的操作数或者结果相关就需要处理，其余指令不过滤
+    bool isRelevant(const Instruction *inst) const {
+        if (const StoreInst *store = dyn_cast<StoreInst>(inst)) {
+            return isRelevantValue(store->getValueOperand()) || isRelevantValue(store->getPointerOperand());
+        }
+        if (const LoadInst *load = dyn_cast<LoadInst>(inst)) {
+            return isRelevantValue(load) || isRelevantValue(load->getPointerOperand());
+        }
+        if (const GetElementPtrInst *gep = dyn_cast<GetElementPtrInst>(inst)) {
+            return isRelevantValue(gep) || isRelevantValue(gep->getPointerOperand());
+        }
+        return true;
+    }
+
+    size_t size() const { return relevant.size(); }
+
+private:
+    std::set<const Value *> relevant;
+    std::vector<Value *> worklist;
+    std::set<Type *> visitingTypes;
+
+    void mark(Value *val) {
+        if (isa<ConstantData>(val)) return;
+        if (relevant.insert(val).second) {
+            worklist.push_back(val);
+        }
+    }
+
+    /// 类型里是否可能装着函数指针，递归结构体用 visitingTypes 防止死循环
+    bool carriesFuncPtr(Type *ty) {
+        if (ty->isFunctionTy()) return true;
+        if (!ty->isPointerTy() && !ty->isStructTy() && !ty->isArrayTy() && !ty->isVectorTy()) {
+            return false;
+        }
+        if (!visitingTypes.insert(ty).second) return false;
+        bool result = false;
+        for (unsigned i = 0, n = ty->getNumContainedTypes(); i < n && !result; i++) {
+            result = carriesFuncPtr(ty->getContainedType(i));
+        }
+        visitingTypes.erase(ty);
+        return result;
+    }
+
+    void propagate(Value *val) {
+        if (LoadInst *load = dyn_cast<LoadInst>(val)) {
+            mark(load->getPointerOperand());
+        } else if (GetElementPtrInst *gep = dyn_cast<GetElementPtrInst>(val)) {
+            mark(gep->getPointerOperand());
+        } else if (CastInst *cast = dyn_cast<CastInst>(val)) {
+            mark(cast->getOperand(0));
+        } else if (PHINode *phi = dyn_cast<PHINode>(val)) {
+            for (Value *incoming : phi->incoming_values()) mark(incoming);
+        } else if (SelectInst *select = dyn_cast<SelectInst>(val)) {
+            mark(select->getTrueValue());
+            mark(select->getFalseValue());
+        } else if (CallInst *call = dyn_cast<CallInst>(val)) {
+            if (Function *callee = call->getCalledFunction()) {
+                for (BasicBlock &BB : *callee) {
+                    if (ReturnInst *ret = dyn_cast<ReturnInst>(BB.getTerminator())) {
+                        if (ret->getReturnValue()) mark(ret->getReturnValue());
+                    }
+                }
+            }
+        } else if (Argument *arg = dyn_cast<Argument>(val)) {
+            for (User *user : arg->getParent()->users()) {
+                CallInst *call = dyn_cast<CallInst>(user);
+                if (call && call->getCalledOperand() == arg->getParent()
+                    && arg->getArgNo() < call->arg_size()) {
+                    mark(call->getArgOperand(arg->getArgNo()));
+                }
+            }
+        }
+
+        // 作为内存位置：写进去的值和 memcpy 的来源也相关
+        for (User *user : val->users()) {
+            if (StoreInst *store = dyn_cast<StoreInst>(user)) {
+                if (store->getPointerOperand() == val) mark(store->getValueOperand());
+            } else if (MemCpyInst *memcpy = dyn_cast<MemCpyInst>(user)) {
+                if (memcpy->getDest() == val) mark(memcpy->getSource());
+            }
+        }
+    }
+};
+
+#endif //ASSIGN3_RELEVANCE_H
@@ -0,0 +1,389 @@
+#ifndef ASSIGN3_RESULTS_FILE_H
+#define ASSIGN3_RESULTS_FILE_H
+
+#include "FuncPtrAnalysis.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+/// 分析结果的二进制格式（-emit-results 写，ResultsFileReader 读）。
+///
+/// 整个文件都是小端的 uint32_t，所有记录 4 字节对齐，读的时候 mmap 进来直接按数组访问，不需要解析：
+///     header : magic, version, flags, 段的个数, 然后每段一个 (字节偏移, 元素个数)
+///     段     : 见 ResultsFile::Section，字符串表里的字符串以 '\0' 结尾
+/// 函数名、值名都放在字符串表里，其他地方只存下标。
+/// 每个调用点的被调函数是 CallSiteCallees 里 [calleeBegin, calleeEnd) 这一段函数下标；
+/// 和命令行一样按行号汇总的结果另外存一份（行号 -> 函数名）。
+/// 行和调用点记录里的 flags 标出不精确的结果：行是按类型退化得到的（命令行输出里的 [degraded]），
+/// 调用点的目标里有按类型补上的函数（FuncPtrAnalysis::isApproximated）。
+/// 写的时候带上 -emit-points-to 还会存每个基本块出口处的 pointToSets。
+/// 格式变了就加 version，读的时候版本不对直接拒绝。
+namespace ResultsFile {
+
+const uint32_t Magic = 0x31525046; // "FPR1"
+const uint32_t Version = 2;
+const uint32_t HasPointsTo = 1;
+
+// LineRecord::flags
+const uint32_t LineDegraded = 1;
+// CallSiteRecord::flags
+const uint32_t CallSiteApproximated = 1;
+
+enum Section : uint32_t {
+    StringOffsets,    // uint32_t[字符串个数 + 1]，字符串 i 在 StringData 里的起始偏移
+    StringData,       // char[]
+    Functions,        // uint32_t 函数名的字符串下标
+    Lines,            // LineRecord，按行号排序
+    LineCallees,      // uint32_t 字符串下标
+    CallSites,        // CallSiteRecord，按 (function, instIndex) 排序
+    CallSiteCallees,  // uint32_t 函数下标
+    Blocks,           // BlockRecord，按 (function, block) 排序
+    PointsTo,         // PointsToRecord，指针按字符串下标排序
+    PointsToTargets,  // uint32_t 字符串下标
+    NumSections
+};
+
+struct LineRecord {
+    uint32_t line, calleeBegin, calleeEnd, flags;
+};
+
+struct CallSiteRecord {
+    uint32_t function, line, instIndex, calleeBegin, calleeEnd, flags;
+};
+
+struct BlockRecord {
+    uint32_t function, block, pointsToBegin, pointsToEnd;
+};
+
+struct PointsToRecord {
+    uint32_t pointer, targetBegin, targetEnd;
+};
+
+/// 写文件：先把各段攒在内存里，最后一次写出
+class Writer {
+public:
+    Writer(FuncPtrAnalysis &analysis, Module &M) : analysis(analysis), M(M), MST(&M) {}
+
+    /// 出错时返回错误信息，成功返回空字符串
+    std::string write(StringRef path, bool withPointsTo) {
+        for (Function &F : M) {
+            if (F.isIntrinsic()) continue;
+            functionIds[&F] = functions.size();
+            functions.push_back(intern(F.getName()));
+        }
+
+        for (const auto &result : analysis.getLineResults()) {
+            if (result.second.empty()) continue;
+            uint32_t flags = analysis.getDegradedLines().count(result.first) ? LineDegraded : 0;
+            lines.push_back({result.first, (uint32_t)lineCallees.size(), 0, flags});
+            for (const std::string &callee : result.second) lineCallees.push_back(intern(callee));
+            lines.back().calleeEnd = lineCallees.size();
+        }
+
+        for (Function &F : M) {
+            if (F.isDeclaration()) continue;
+            uint32_t instIndex = 0;
+            for (BasicBlock &BB : F) {
+                for (Instruction &I : BB) {
+                    instIndex++;
+                    CallInst *call = dyn_cast<CallInst>(&I);
+                    if (!call) continue;
+                    std::vector<const Function *> callees = analysis.getCallees(call);
+                    if (callees.empty()) continue;
+                    unsigned line = call->getDebugLoc() ? call->getDebugLoc().getLine() : 0;
+                    CallSiteRecord record = {functionIds[&F], line, instIndex - 1,
+                                             (uint32_t)callSiteCallees.size(), 0,
+                                             analysis.isApproximated(call) ? CallSiteApproximated : 0};
+                    for (const Function *callee : callees) {
+                        callSiteCallees.push_back(functionIds[callee]);
+                    }
+                    record.calleeEnd = callSiteCallees.size();
+                    callSites.push_back(record);
+                }
+            }
+        }
+
+        if (withPointsTo) {
+            collectPointsTo();
+        }
+
+        std::error_code EC;
+        raw_fd_ostream out(path, EC, sys::fs::OF_None);
+        if (EC) return EC.message();
+
+        std::vector<uint32_t> stringOffsets;
+        for (const std::string &str : strings) {
+            stringOffsets.push_back(stringData.size());
+            stringData.append(str);
+            stringData.push_back('\0');
+        }
+        stringOffsets.push_back(stringData.size());
+        while (stringData.size() % 4) stringData.push_back('\0');
+
+        std::vector<StringRef> sections(NumSections);
+        std::vector<uint32_t> counts(NumSections);
+        auto set = [&](Section section, const void *data, size_t bytes, size_t count) {
+            sections[section] = StringRef(static_cast<const char *>(data), bytes);
+            counts[section] = count;
+        };
+        set(StringOffsets, stringOffsets.data(), stringOffsets.size() * 4, stringOffsets.size());
+        set(StringData, stringData.data(), stringData.size(), stringData.size());
+        set(Functions, functions.data(), functions.size() * 4, functions.size());
+        set(Lines, lines.data(), lines.size() * sizeof(LineRecord), lines.size());
+        set(LineCallees, lineCallees.data(), lineCallees.size() * 4, lineCallees.size());
+        set(CallSites, callSites.data(), callSites.size() * sizeof(CallSiteRecord), callSites.size());
+        set(CallSiteCallees, callSiteCallees.data(), callSiteCallees.size() * 4, callSiteCallees.size());
+        set(Blocks, blocks.data(), blocks.size() * sizeof(BlockRecord), blocks.size());
+        set(PointsTo, pointsTo.data(), pointsTo.size() * sizeof(PointsToRecord), pointsTo.size());
+        set(PointsToTargets, pointsToTargets.data(), pointsToTargets.size() * 4, pointsToTargets.size());
+
+        std::vector<uint32_t> header = {Magic, Version, withPointsTo ? HasPointsTo : 0, NumSections};
+        uint32_t offset = (header.size() + 2 * NumSections) * 4;
+        for (unsigned i = 0; i < NumSections; i++) {
+            header.push_back(offset);
+            header.push_back(counts[i]);
+            offset += sections[i].size();
+        }
+        out.write(reinterpret_cast<const char *>(header.data()), header.size() * 4);
+        for (StringRef section : sections) out << section;
+        out.close();
+        return out.has_error() ? "write error" : "";
+    }
+
+private:
+    FuncPtrAnalysis &analysis;
+    Module &M;
+    ModuleSlotTracker MST;
+
+    std::vector<std::string> strings;
+    StringMap<uint32_t> stringIds;
+    std::map<const Function *, uint32_t> functionIds;
+    std::string stringData;
+    std::vector<uint32_t> functions, lineCallees, callSiteCallees, pointsToTargets;
+    std::vector<LineRecord> lines;
+    std::vector<CallSiteRecord> callSites;
+    std::vector<BlockRecord> blocks;
+    std::vector<PointsToRecord> pointsTo;
+
+    uint32_t intern(StringRef str) {
+        auto inserted = stringIds.insert(std::make_pair(str, (uint32_t)strings.size()));
+        if (inserted.second) strings.push_back(str.str());
+        return inserted.first->second;
+    }
+
+    /// 全局值 "@name"，函数里的值 "函数名:%name"，没有名字的用打印出来的编号
+    uint32_t internValue(const Value *val) {
+        if (PointToInfo::isTop(val)) return intern("<top>");
+        std::string name;
+        raw_string_ostream os(name);
+        if (const Instruction *inst = dyn_cast<Instruction>(val)) {
+            os << inst->getFunction()->getName() << ":";
+        } else if (const Argument *arg = dyn_cast<Argument>(val)) {
+            os << arg->getParent()->getName() << ":";
+        }
+        val->printAsOperand(os, false, MST);
+        return intern(os.str());
+    }
+
+    void collectPointsTo() {
+        for (Function &F : M) {
+            auto states = analysis.getVisitor().functionStates.find(&F);
+            if (states == analysis.getVisitor().functionStates.end()) continue;
+            uint32_t blockIndex = 0;
+            for (BasicBlock &BB : F) {
+                auto state = states->second.find(&BB);
+                blockIndex++;
+                if (state == states->second.end()) continue;
+
+                // 按字符串下标排序，读的时候可以二分
+                std::vector<std::pair<uint32_t, std::vector<uint32_t>>> entries;
+                for (const auto &pts : state->second.second.pointToSets) {
+                    std::vector<uint32_t> targets;
+                    for (Value *target : pts.second) targets.push_back(internValue(target));
+                    std::sort(targets.begin(), targets.end());
+                    entries.emplace_back(internValue(pts.first), std::move(targets));
+                }
+                std::sort(entries.begin(), entries.end());
+
+                BlockRecord record = {functionIds[&F], blockIndex - 1, (uint32_t)pointsTo.size(), 0};
+                for (const auto &entry : entries) {
+                    pointsTo.push_back({entry.first, (uint32_t)pointsToTargets.size(), 0});
+                    pointsToTargets.insert(pointsToTargets.end(), entry.second.begin(), entry.second.end());
+                    pointsTo.back().targetEnd = pointsToTargets.size();
+                }
+                record.pointsToEnd = pointsTo.size();
+                blocks.push_back(record);
+            }
+        }
+    }
+};
+
+/// 只读访问：构造时检查头部和每段的边界，之后所有查询都是直接索引或者二分
+class Reader {
+public:
+    /// 出错时返回空指针并把原因写进 error
+    static std::unique_ptr<Reader> open(StringRef path, std::string &error) {
+#if LLVM_VERSION_MAJOR >= 13
+        ErrorOr<std::unique_ptr<MemoryBuffer>> buffer =
+            MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+#else
+        ErrorOr<std::unique_ptr<MemoryBuffer>> buffer =
+            MemoryBuffer::getFile(path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+#endif
+        if (!buffer) {
+            error = buffer.getError().message();
+            return nullptr;
+        }
+        std::unique_ptr<Reader> reader(new Reader(std::move(*buffer)));
+        error = reader->validate();
+        if (!error.empty()) return nullptr;
+        return reader;
+    }
+
+    bool hasPointsTo() const { return word(2) & HasPointsTo; }
+
+    uint32_t numStrings() const { return count(StringOffsets) - 1; }
+    StringRef string(uint32_t id) const {
+        ArrayRef<uint32_t> offsets = array<uint32_t>(StringOffsets);
+        return StringRef(base() + offset(StringData) + offsets[id], offsets[id + 1] - offsets[id] - 1);
+    }
+
+    ArrayRef<uint32_t> functions() const { return array<uint32_t>(Functions); }
+    StringRef functionName(uint32_t function) const { return string(functions()[function]); }
+
+    ArrayRef<LineRecord> lines() const { return array<LineRecord>(Lines); }
+    ArrayRef<uint32_t> lineCallees(const LineRecord &line) const {
+        return array<uint32_t>(LineCallees).slice(line.calleeBegin, line.calleeEnd - line.calleeBegin);
+    }
+    /// 某一行上调用的函数名（字符串下标），没有时为空
+    ArrayRef<uint32_t> calleesAtLine(uint32_t line) const {
+        ArrayRef<LineRecord> all = lines();
+        auto it = std::lower_bound(all.begin(), all.end(), line,
+                                   [](const LineRecord &record, uint32_t l) { return record.line < l; });
+        if (it == all.end() || it->line != line) return ArrayRef<uint32_t>();
+        return lineCallees(*it);
+    }
+
+    ArrayRef<CallSiteRecord> callSites() const { return array<CallSiteRecord>(CallSites); }
+    ArrayRef<uint32_t> callees(const CallSiteRecord &site) const {
+        return array<uint32_t>(CallSiteCallees).slice(site.calleeBegin, site.calleeEnd - site.calleeBegin);
+    }
+
+    ArrayRef<BlockRecord> blocks() const { return array<BlockRecord>(Blocks); }
+    ArrayRef<PointsToRecord> pointsTo(const BlockRecord &block) const {
+        return array<PointsToRecord>(PointsTo).slice(block.pointsToBegin, block.pointsToEnd - block.pointsToBegin);
+    }
+    ArrayRef<uint32_t> targets(const PointsToRecord &pts) const {
+        return array<uint32_t>(PointsToTargets).slice(pts.targetBegin, pts.targetEnd - pts.targetBegin);
+    }
+
+    /// 和 PointToVisitor::printResults 一样的文本（不包括最后说明退化原因的 note）
+    void printLines(raw_ostream &out) const {
+        for (const LineRecord &line : lines()) {
+            out << line.line << " : ";
+            ArrayRef<uint32_t> callees = lineCallees(line);
+            for (size_t i = 0; i < callees.size(); i++) {
+                if (i) out << ", ";
+                out << string(callees[i]);
+            }
+            if (line.flags & LineDegraded) {
+                out << " [degraded]";
+            }
+            out << "\n";
+        }
+    }
+
+private:
+    std::unique_ptr<MemoryBuffer> buffer;
+
+    explicit Reader(std::unique_ptr<MemoryBuffer> buffer) : buffer(std::move(buffer)) {}
+
+    const char *base() const { return buffer->getBufferStart(); }
+    uint32_t word(size_t i) const { return reinterpret_cast<const uint32_t *>(base())[i]; }
+    uint32_t offset(Section section) const { return word(4 + 2 * section); }
+    uint32_t count(Section section) const { return word(5 + 2 * section); }
+
+    template <typename T>
+    ArrayRef<T> array(Section section) const {
+        return ArrayRef<T>(reinterpret_cast<const T *>(base() + offset(section)), count(section));
+    }
+
+    template <typename T>
+    bool recordsFit(Section section) const {
+        uint64_t end = (uint64_t)offset(section) + (uint64_t)count(section) * sizeof(T);
+        return offset(section) % 4 == 0 && end <= buffer->getBufferSize();
+    }
+
+    template <typename T>
+    bool rangesFit(ArrayRef<T> records, uint32_t T::*begin, uint32_t T::*end, Section target) const {
+        for (const T &record : records) {
+            if (record.*begin > record.*end || record.*end > count(target)) return false;
+        }
+        return true;
+    }
+
+    std::string validate() const {
+        if (!sys::IsLittleEndianHost) return "big-endian hosts are not supported";
+        size_t size = buffer->getBufferSize();
+        if (size < 16 || (uintptr_t)base() % 4 != 0) return "not a results file";
+        if (word(0) != Magic) return "not a results file";
+        if (word(1) != Version) return "unsupported results file version " + std::to_string(word(1));
+        if (word(3) < NumSections || size < 16 + 8 * (size_t)word(3)) return "truncated header";
+
+        if (!recordsFit<uint32_t>(StringOffsets) || !recordsFit<char>(StringData)
+            || !recordsFit<uint32_t>(Functions) || !recordsFit<LineRecord>(Lines)
+            || !recordsFit<uint32_t>(LineCallees) || !recordsFit<CallSiteRecord>(CallSites)
+            || !recordsFit<uint32_t>(CallSiteCallees) || !recordsFit<BlockRecord>(Blocks)
+            || !recordsFit<PointsToRecord>(PointsTo) || !recordsFit<uint32_t>(PointsToTargets)) {
+            return "section out of bounds";
+        }
+        if (count(StringOffsets) == 0) return "missing string table";
+        ArrayRef<uint32_t> offsets = array<uint32_t>(StringOffsets);
+        for (size_t i = 0; i + 1 < offsets.size(); i++) {
+            if (offsets[i] >= offsets[i + 1] || offsets[i + 1] > count(StringData)) return "bad string table";
+        }
+
+        // 下标也要检查，之后的查询就不用再判断越界
+        uint32_t strings = numStrings();
+        auto idsFit = [](ArrayRef<uint32_t> ids, uint32_t limit) {
+            return std::all_of(ids.begin(), ids.end(), [limit](uint32_t id) { return id < limit; });
+        };
+        if (!idsFit(functions(), strings) || !idsFit(array<uint32_t>(LineCallees), strings)
+            || !idsFit(array<uint32_t>(CallSiteCallees), functions().size())
+            || !idsFit(array<uint32_t>(PointsToTargets), strings)) {
+            return "id out of range";
+        }
+        if (!rangesFit(lines(), &LineRecord::calleeBegin, &LineRecord::calleeEnd, LineCallees)
+            || !rangesFit(callSites(), &CallSiteRecord::calleeBegin, &CallSiteRecord::calleeEnd, CallSiteCallees)
+            || !rangesFit(blocks(), &BlockRecord::pointsToBegin, &BlockRecord::pointsToEnd, PointsTo)
+            || !rangesFit(array<PointsToRecord>(PointsTo), &PointsToRecord::targetBegin,
+                          &PointsToRecord::targetEnd, PointsToTargets)) {
+            return "range out of bounds";
+        }
+        for (const CallSiteRecord &site : callSites()) {
+            if (site.function >= functions().size()) return "id out of range";
+        }
+        for (const BlockRecord &block : blocks()) {
+            if (block.function >= functions().size()) return "id out of range";
+        }
+        for (const PointsToRecord &pts : array<PointsToRecord>(PointsTo)) {
+            if (pts.pointer >= strings) return "id out of range";
+        }
+        return "";
+    }
+};
+
+} // namespace ResultsFile
+
+#endif //ASSIGN3_RESULTS_FILE_H
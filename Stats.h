@@ -0,0 +1,174 @@
+#ifndef ASSIGN3_STATS_H
+#define ASSIGN3_STATS_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+using namespace llvm;
+
+/// 分析过程的统计（-stats）。访问者里只放一个指针，为空时每个记录点只多一次判空，不计时也不查表。
+///
+///   handlers   : 每种降低后的操作（LoweredOp::Kind）执行的次数和自身耗时。
+///                call 会递归分析被调函数，被调函数里各个操作的时间记在它们自己的种类上，
+///                不重复算进 call，所以各行加起来就是执行指令的总时间
+///   functions  : 每个函数前向/后向求解的次数和基本块访问次数，以及作为被调函数完整分析的次数和走 summary 快速路径的次数
+///   maxState   : 基本块出口处 PointToInfo 的最大规模（key 个数和集合元素总数）
+///   memory     : 估算的字节数（见 MemoryUsage.h）。每个函数一次求解的 DataflowResult 的最大值；
+///                递归栈上同时存在的所有 DataflowResult 之和的峰值，以及峰值时 bindings、pointToSets
+///                和其他（解析缓存、LiveVars）各占多少；分析结束时常驻的各部分（results 里的字符串、
+///                保留的状态、活跃变量结果、降低后的操作、summary）
+struct AnalysisStats {
+    static constexpr unsigned NumHandlers = 6;
+
+    struct Handler {
+        uint64_t count = 0;
+        uint64_t nanos = 0;
+    };
+
+    struct FunctionStats {
+        uint64_t forwardSolves = 0, forwardVisits = 0;
+        uint64_t backwardSolves = 0, backwardVisits = 0;
+        uint64_t calleeAnalyses = 0, summaryHits = 0;
+        size_t peakResultBytes = 0;
+    };
+
+    Handler handlers[NumHandlers];
+    std::map<const Function *, FunctionStats> functions;
+    uint64_t mallocCalls = 0;
+    size_t maxStateKeys = 0, maxStateEntries = 0;
+    const Function *maxStateFunction = nullptr;
+
+    size_t peakLiveBytes = 0, peakLiveBindingBytes = 0, peakLivePointToSetBytes = 0, peakLiveOtherBytes = 0;
+    unsigned peakLiveDepth = 0;
+    std::vector<std::pair<std::string, size_t>> components;
+
+    /// 和 LoweredOp::Kind 的顺序一致
+    static const char *handlerName(unsigned kind) {
+        static const char *names[NumHandlers] = {"store", "load", "getelementptr", "memcpy", "call", "ret"};
+        return kind < NumHandlers ? names[kind] : "?";
+    }
+
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// 给一次操作计时，嵌套在里面的操作（被调函数里的指令）的时间从外层扣掉
+    class HandlerTimer {
+    public:
+        HandlerTimer(AnalysisStats &stats, unsigned kind)
+            : stats(stats), kind(kind), savedChild(stats.childNanos), start(now()) {
+            stats.childNanos = 0;
+        }
+        ~HandlerTimer() {
+            uint64_t elapsed = now() - start;
+            Handler &handler = stats.handlers[kind];
+            handler.count++;
+            handler.nanos += elapsed - std::min(elapsed, stats.childNanos);
+            stats.childNanos = savedChild + elapsed;
+        }
+
+    private:
+        AnalysisStats &stats;
+        unsigned kind;
+        uint64_t savedChild, start;
+    };
+
+    void recordState(const Function *fn, size_t keys, size_t entries) {
+        if (keys + entries <= maxStateKeys + maxStateEntries) return;
+        maxStateKeys = keys;
+        maxStateEntries = entries;
+        maxStateFunction = fn;
+    }
+
+    void recordLive(unsigned depth, size_t bindingBytes, size_t pointToSetBytes, size_t otherBytes) {
+        size_t total = bindingBytes + pointToSetBytes + otherBytes;
+        if (total <= peakLiveBytes) return;
+        peakLiveBytes = total;
+        peakLiveBindingBytes = bindingBytes;
+        peakLivePointToSetBytes = pointToSetBytes;
+        peakLiveOtherBytes = otherBytes;
+        peakLiveDepth = depth;
+    }
+
+    static std::string kilobytes(size_t bytes) {
+        std::string text;
+        raw_string_ostream os(text);
+        os << format("%.1f KB", bytes / 1024.0);
+        return os.str();
+    }
+
+    /// 函数名在这里取，所以要在模块释放之前打印
+    void print(raw_ostream &out) const {
+        out << "===- funcptr statistics -===\n";
+        uint64_t totalCount = 0, totalNanos = 0;
+        out << "  handler                 count      self ms\n";
+        for (unsigned kind = 0; kind < NumHandlers; kind++) {
+            const Handler &handler = handlers[kind];
+            out << format("  %-16s %12llu %12.3f\n", handlerName(kind),
+                          (unsigned long long)handler.count, handler.nanos / 1e6);
+            totalCount += handler.count;
+            totalNanos += handler.nanos;
+        }
+        out << format("  %-16s %12llu %12.3f\n", static_cast<const char *>("total"),
+                      (unsigned long long)totalCount, totalNanos / 1e6);
+
+        // 按前向访问次数从多到少，次数相同按函数名
+        std::vector<std::pair<const Function *, const FunctionStats *>> sorted;
+        for (const auto &fn : functions) sorted.push_back(std::make_pair(fn.first, &fn.second));
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<const Function *, const FunctionStats *> &a,
+                                                   const std::pair<const Function *, const FunctionStats *> &b) {
+            if (a.second->forwardVisits != b.second->forwardVisits) {
+                return a.second->forwardVisits > b.second->forwardVisits;
+            }
+            return a.first->getName() < b.first->getName();
+        });
+        uint64_t calleeAnalyses = 0, summaryHits = 0;
+        out << "  function                 fwd solves fwd blocks bwd solves bwd blocks   analysed    summary  peak KB\n";
+        for (const auto &fn : sorted) {
+            const FunctionStats &s = *fn.second;
+            out << format("  %-24s %10llu %10llu %10llu %10llu %10llu %10llu %8.1f\n", fn.first->getName().str().c_str(),
+                          (unsigned long long)s.forwardSolves, (unsigned long long)s.forwardVisits,
+                          (unsigned long long)s.backwardSolves, (unsigned long long)s.backwardVisits,
+                          (unsigned long long)s.calleeAnalyses, (unsigned long long)s.summaryHits,
+                          s.peakResultBytes / 1024.0);
+            calleeAnalyses += s.calleeAnalyses;
+            summaryHits += s.summaryHits;
+        }
+        out << "  callee analyses: " << calleeAnalyses << ", summary hits: " << summaryHits
+            << ", malloc calls: " << mallocCalls << "\n";
+        out << "  max state: " << maxStateKeys << " keys, " << maxStateEntries << " entries";
+        if (maxStateFunction) out << " (in " << maxStateFunction->getName() << ")";
+        out << "\n";
+
+        out << "  peak live states: " << kilobytes(peakLiveBytes) << " at call depth " << peakLiveDepth
+            << " (bindings " << kilobytes(peakLiveBindingBytes) << ", points-to sets "
+            << kilobytes(peakLivePointToSetBytes) << ", other " << kilobytes(peakLiveOtherBytes) << ")\n";
+        size_t resident = 0;
+        for (const auto &component : components) resident += component.second;
+        out << "  resident after analysis: " << kilobytes(resident) << "\n";
+        for (const auto &component : components) {
+            out << format("    %-22s", component.first.c_str()) << kilobytes(component.second) << "\n";
+        }
+#ifdef __linux__
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        out << "  process peak RSS: " << usage.ru_maxrss << " KB\n";
+#endif
+    }
+
+private:
+    // 当前操作里已经结束的嵌套操作的总时间，见 HandlerTimer
+    uint64_t childNanos = 0;
+};
+
+#endif //ASSIGN3_STATS_H
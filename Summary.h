@@ -0,0 +1,261 @@
+#ifndef ASSIGN3_SUMMARY_H
+#define ASSIGN3_SUMMARY_H
+
+#include "FuncPtrAnalysis.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+/// 分开分析：每个编译单元（TU）单独分析，得到一个 JSON 摘要（-emit-summary），
+/// 最后 -link 把所有摘要合并起来，解析跨 TU 的调用目标。每个 TU 的那一步互相独立，可以并行跑。
+///
+/// 摘要里记录：
+///   functions    : 每个定义的函数，是否导出，签名，函数里的直接调用（行号 -> 被调函数名）
+///                  和间接调用（行号、签名、本地分析得到的目标、目标是否完整）
+///   addressTaken : 地址被取走的函数（包括声明），以及它们的签名
+///   external     : 直接调用了但本 TU 里没有定义的函数
+///
+/// 本地分析和命令行一样从 TU 里最后一个定义的函数开始。只有本地分析走到了这个调用点，
+/// 并且 TU 没有和外部交换函数指针的可能（见 isClosed）时，本地得到的目标才算完整。不完整的间接调用在链接时再加上所有 TU 里签名相同的取了地址的函数。
+///
+/// 链接时从入口函数（导出的 main，没有的话是最后一个摘要的入口）出发，沿直接调用和解析出的间接调用
+/// 走到的函数才输出结果，输出和批处理模式一样每个 TU 一段。
+namespace Summary {
+
+const int64_t Version = 1;
+
+inline std::string typeString(Type *type) {
+    std::string text;
+    raw_string_ostream os(text);
+    type->print(os);
+    return os.str();
+}
+
+/// 类型里（穿过指针、结构体、数组）是否可能有函数指针
+inline bool carriesFuncPtr(Type *type, std::set<Type *> &visiting) {
+    if (type->isFunctionTy()) return true;
+    if (!visiting.insert(type).second) return false;
+    bool result = false;
+    for (unsigned i = 0, n = type->getNumContainedTypes(); i < n && !result; i++) {
+        result = carriesFuncPtr(type->getContainedType(i), visiting);
+    }
+    visiting.erase(type);
+    return result;
+}
+
+/// 本 TU 不会从外部拿到函数指针，也不会把函数指针交给外部：
+/// 外部函数和导出函数的参数、返回值，外部和导出的全局变量，类型里都没有函数指针
+inline bool isClosed(Module &M) {
+    std::set<Type *> visiting;
+    for (Function &F : M) {
+        if (F.isIntrinsic() || F.hasLocalLinkage()) continue;
+        for (Type *param : F.getFunctionType()->params()) {
+            if (carriesFuncPtr(param, visiting)) return false;
+        }
+        if (carriesFuncPtr(F.getReturnType(), visiting)) return false;
+    }
+    for (GlobalVariable &GV : M.globals()) {
+        if (!GV.hasLocalLinkage() && carriesFuncPtr(GV.getValueType(), visiting)) return false;
+    }
+    return true;
+}
+
+/// analysis 需要已经用 keepStates 跑过（getCallees 依赖它）
+inline json::Value build(Module &M, FuncPtrAnalysis &analysis) {
+    bool closed = isClosed(M);
+    const auto &states = analysis.getVisitor().functionStates;
+
+    json::Array functions, addressTaken;
+    std::set<std::string> external;
+    for (Function &F : M) {
+        if (F.isIntrinsic()) continue;
+        if (F.hasAddressTaken()) {
+            addressTaken.push_back(json::Object{{"name", F.getName()},
+                                                {"type", typeString(F.getFunctionType())}});
+        }
+        if (F.isDeclaration()) continue;
+
+        bool reached = states.count(&F) != 0;
+        json::Array calls, indirect;
+        for (BasicBlock &BB : F) {
+            for (Instruction &I : BB) {
+                CallInst *call = dyn_cast<CallInst>(&I);
+                if (!call || isa<IntrinsicInst>(call) || call->isInlineAsm()) continue;
+                int64_t line = call->getDebugLoc() ? call->getDebugLoc().getLine() : 0;
+                if (Function *callee = dyn_cast<Function>(call->getCalledOperand()->stripPointerCasts())) {
+                    calls.push_back(json::Object{{"line", line}, {"callee", callee->getName()}});
+                    if (callee->isDeclaration()) external.insert(callee->getName().str());
+                    continue;
+                }
+                json::Array targets;
+                for (const Function *target : analysis.getCallees(call)) {
+                    targets.push_back(target->getName());
+                }
+                indirect.push_back(json::Object{{"line", line},
+                                                {"type", typeString(call->getFunctionType())},
+                                                {"targets", std::move(targets)},
+                                                {"complete", closed && reached}});
+            }
+        }
+        functions.push_back(json::Object{{"name", F.getName()},
+                                         {"exported", !F.hasLocalLinkage()},
+                                         {"type", typeString(F.getFunctionType())},
+                                         {"calls", std::move(calls)},
+                                         {"indirect", std::move(indirect)}});
+    }
+
+    Function *entry = analysis.getEntryFunction();
+    json::Array externalNames;
+    for (const std::string &name : external) externalNames.push_back(name);
+    return json::Object{{"version", Version},
+                        {"module", M.getSourceFileName()},
+                        {"entry", entry ? json::Value(entry->getName()) : json::Value(nullptr)},
+                        {"functions", std::move(functions)},
+                        {"addressTaken", std::move(addressTaken)},
+                        {"external", std::move(externalNames)}};
+}
+
+/// 把若干个摘要合并起来
+class Linker {
+public:
+    /// 读入一个摘要文件，出错时返回错误信息
+    std::string add(const std::string &file) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(file);
+        if (!buffer) return buffer.getError().message();
+        Expected<json::Value> value = json::parse((*buffer)->getBuffer());
+        if (!value) return toString(value.takeError());
+        const json::Object *root = value->getAsObject();
+        if (!root || root->getInteger("version") != Version) return "not a version 1 summary";
+        // 先放进 summaries 再取里面的指针，之后不会再移动
+        summaries.push_back(std::move(*value));
+        root = summaries.back().getAsObject();
+
+        unsigned tu = units.size();
+        units.emplace_back();
+        Unit &unit = units.back();
+        unit.file = file;
+        if (auto entry = root->getString("entry")) unit.entry = entry->str();
+        if (const json::Array *functions = root->getArray("functions")) {
+            for (const json::Value &fnValue : *functions) {
+                const json::Object *fn = fnValue.getAsObject();
+                if (!fn || !fn->getString("name")) return "malformed function entry";
+                std::string name = fn->getString("name")->str();
+                unit.functions[name] = fn;
+                if (fn->getBoolean("exported").getValueOr(false)) {
+                    // 同名的导出函数以先出现的为准
+                    exported.insert(std::make_pair(name, std::make_pair(tu, fn)));
+                }
+            }
+        }
+        if (const json::Array *taken = root->getArray("addressTaken")) {
+            for (const json::Value &takenValue : *taken) {
+                const json::Object *fn = takenValue.getAsObject();
+                if (!fn || !fn->getString("name") || !fn->getString("type")) continue;
+                addressTaken[fn->getString("type")->str()].insert(fn->getString("name")->str());
+            }
+        }
+        return "";
+    }
+
+    /// 从入口出发解析调用目标，按输入顺序每个 TU 输出一段 "==> 文件 <==" 和 "行号 : 被调函数"
+    void link(raw_ostream &out) {
+        std::vector<std::map<unsigned, std::set<std::string>>> results(units.size());
+        std::set<std::pair<unsigned, const json::Object *>> visited;
+        std::deque<std::pair<unsigned, const json::Object *>> worklist;
+        auto enqueue = [&](unsigned tu, const std::string &name) {
+            std::pair<unsigned, const json::Object *> target = resolve(tu, name);
+            if (target.second && visited.insert(target).second) worklist.push_back(target);
+        };
+
+        auto main = exported.find("main");
+        if (main != exported.end()) {
+            visited.insert(main->second);
+            worklist.push_back(main->second);
+        } else if (!units.empty() && !units.back().entry.empty()) {
+            enqueue(units.size() - 1, units.back().entry);
+        }
+
+        while (!worklist.empty()) {
+            unsigned tu = worklist.front().first;
+            const json::Object *fn = worklist.front().second;
+            worklist.pop_front();
+
+            if (const json::Array *calls = fn->getArray("calls")) {
+                for (const json::Value &callValue : *calls) {
+                    const json::Object *call = callValue.getAsObject();
+                    if (!call || !call->getString("callee")) continue;
+                    std::string callee = call->getString("callee")->str();
+                    results[tu][call->getInteger("line").getValueOr(0)].insert(callee);
+                    enqueue(tu, callee);
+                }
+            }
+            if (const json::Array *indirect = fn->getArray("indirect")) {
+                for (const json::Value &siteValue : *indirect) {
+                    const json::Object *site = siteValue.getAsObject();
+                    if (!site) continue;
+                    std::set<std::string> targets;
+                    if (const json::Array *local = site->getArray("targets")) {
+                        for (const json::Value &target : *local) {
+                            if (auto name = target.getAsString()) targets.insert(name->str());
+                        }
+                    }
+                    if (!site->getBoolean("complete").getValueOr(false) && site->getString("type")) {
+                        const std::set<std::string> &sameType = addressTaken[site->getString("type")->str()];
+                        targets.insert(sameType.begin(), sameType.end());
+                    }
+                    std::set<std::string> &lineResult = results[tu][site->getInteger("line").getValueOr(0)];
+                    for (const std::string &target : targets) {
+                        lineResult.insert(target);
+                        enqueue(tu, target);
+                    }
+                }
+            }
+        }
+
+        for (unsigned tu = 0; tu < units.size(); tu++) {
+            out << "==> " << units[tu].file << " <==\n";
+            for (const auto &result : results[tu]) {
+                if (result.second.empty()) continue;
+                out << result.first << " : ";
+                for (auto it = result.second.begin(); it != result.second.end(); ++it) {
+                    if (it != result.second.begin()) out << ", ";
+                    out << *it;
+                }
+                out << "\n";
+            }
+        }
+    }
+
+private:
+    struct Unit {
+        std::string file;
+        std::string entry;
+        std::map<std::string, const json::Object *> functions;
+    };
+
+    std::deque<json::Value> summaries;  // deque 追加元素时已有元素的地址不变
+    std::vector<Unit> units;
+    std::map<std::string, std::pair<unsigned, const json::Object *>> exported;
+    std::map<std::string, std::set<std::string>> addressTaken;  // 签名 -> 函数名
+
+    /// 调用方 TU 里的定义优先（static 函数），否则找导出的定义；外部库函数返回空
+    std::pair<unsigned, const json::Object *> resolve(unsigned tu, const std::string &name) {
+        auto local = units[tu].functions.find(name);
+        if (local != units[tu].functions.end()) return std::make_pair(tu, local->second);
+        auto global = exported.find(name);
+        if (global != exported.end()) return global->second;
+        return std::make_pair(tu, nullptr);
+    }
+};
+
+} // namespace Summary
+
+#endif //ASSIGN3_SUMMARY_H
@@ -0,0 +1,100 @@
+#ifndef ASSIGN3_TRACE_H
+#define ASSIGN3_TRACE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+/// Chrome / Perfetto 的 trace-event 时间线（-trace=<file>），用 chrome://tracing 或 ui.perfetto.dev 打开。
+///
+/// 每个区间是一个 "ph": "X"（complete）事件，嵌套关系由时间范围体现：
+///   module <文件>      一个模块的整个分析
+///   solve <函数>       一次 compForwardDataflow，args 里是基本块数和访问次数，预算用完中途放弃时有 aborted
+///   block <函数>       worklist 的一次迭代，args 里是基本块编号和出口状态的大小
+///   call <被调函数>     handleCallInst 对被调函数的一次递归分析，args 里是行号和传入、传出的状态大小
+/// 批处理时每个工作线程一条时间线（tid）。
+class TraceRecorder {
+public:
+    TraceRecorder() : origin(std::chrono::steady_clock::now()) {}
+
+    /// 相对于开始记录时的微秒数
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - origin).count();
+    }
+
+    void complete(std::string name, const char *category, uint64_t start, json::Object args) {
+        uint64_t end = now();
+        json::Object event{{"name", std::move(name)},
+                           {"cat", category},
+                           {"ph", "X"},
+                           {"ts", (int64_t)start},
+                           {"dur", (int64_t)(end - start)},
+                           {"pid", 1},
+                           {"tid", (int64_t)threadIndex()}};
+        if (!args.empty()) event["args"] = std::move(args);
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(std::move(event));
+    }
+
+    /// 出错时返回错误信息
+    std::string write(const std::string &path) {
+        std::error_code EC;
+        raw_fd_ostream out(path, EC, sys::fs::OF_Text);
+        if (EC) return EC.message();
+        std::lock_guard<std::mutex> lock(mutex);
+        json::Array traceEvents;
+        for (json::Object &event : events) traceEvents.push_back(std::move(event));
+        events.clear();
+        out << json::Value(json::Object{{"traceEvents", std::move(traceEvents)},
+                                        {"displayTimeUnit", "ms"}}) << "\n";
+        return "";
+    }
+
+private:
+    std::chrono::steady_clock::time_point origin;
+    std::mutex mutex;
+    std::vector<json::Object> events;
+
+    /// 每个线程第一次记录事件时分配一个编号
+    static unsigned threadIndex() {
+        static std::atomic<unsigned> next(0);
+        thread_local unsigned index = next++;
+        return index;
+    }
+};
+
+/// 一个区间：构造时开始，析构时记录。recorder 为空时什么都不做，name 也不会被拷贝。
+class TraceScope {
+public:
+    TraceScope(TraceRecorder *recorder, const char *category, StringRef name)
+        : recorder(recorder), category(category), name(name), start(recorder ? recorder->now() : 0) {}
+
+    ~TraceScope() {
+        if (recorder) recorder->complete((StringRef(category) + " " + name).str(), category, start, std::move(args));
+    }
+
+    bool enabled() const { return recorder != nullptr; }
+
+    /// 事件在分析结束后才写出，这时 Module 可能已经释放了，字符串要传 std::string（json::Value 不拷贝 StringRef）
+    void arg(StringRef key, json::Value value) {
+        if (recorder) args[key] = std::move(value);
+    }
+
+private:
+    TraceRecorder *recorder;
+    const char *category;
+    StringRef name;
+    uint64_t start;
+    json::Object args;
+};
+
+#endif //ASSIGN3_TRACE_H
@@ -0,0 +1,150 @@
+//===- FuncPtrBench.cpp - end-to-end timing of the funcptr analysis -------===//
+//
+// funcptr-bench [-repeat N] [-o out.json] <file.bc | directory> ...
+//
+// 每个输入重复分析 N 次，每次都重新解析并做 mem2reg，只对分析本身计时。
+// 输出 JSON，便于前后两次运行对比：
+//   wallMs          分析耗时的最小值 / 中位数 / 平均值（毫秒）
+//   peakRssKB       分析完这个输入后进程的峰值 RSS（getrusage，单调不减，按输入顺序看增量）
+//   blockVisits     一次分析里基本块被求值的次数
+//   calleeAnalyses  一次分析里被调函数被重新分析的次数
+//
+//===----------------------------------------------------------------------===//
+
+#include "FuncPtrAnalysis.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string>
+Inputs(cl::Positional, cl::desc("<filename>.bc | <directory> ..."), cl::OneOrMore);
+
+static cl::opt<unsigned>
+Repeat("repeat", cl::desc("Number of timed runs per input"), cl::init(5));
+
+static cl::opt<std::string>
+Output("o", cl::desc("Write the JSON report here instead of stdout"), cl::value_desc("file"),
+       cl::init("-"));
+
+/// 目录按文件名排序展开成里面的 .bc / .ll
+static std::vector<std::string> collectInputs() {
+    std::vector<std::string> files;
+    for (const std::string &input : Inputs) {
+        if (!sys::fs::is_directory(input)) {
+            files.push_back(input);
+            continue;
+        }
+        std::vector<std::string> entries;
+        std::error_code EC;
+        for (sys::fs::directory_iterator it(input, EC), end; it != end && !EC; it.increment(EC)) {
+            StringRef ext = sys::path::extension(it->path());
+            if (ext == ".bc" || ext == ".ll") entries.push_back(it->path());
+        }
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    }
+    return files;
+}
+
+static int64_t peakRssKB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static json::Value benchmark(const std::string &file) {
+    std::vector<double> times;
+    int64_t functions = 0, instructions = 0, callSites = 0;
+    uint64_t blockVisits = 0, calleeAnalyses = 0;
+
+    for (unsigned i = 0; i < std::max(1u, (unsigned)Repeat); i++) {
+        LLVMContext context;
+        SMDiagnostic err;
+        std::unique_ptr<Module> M = parseIRFile(file, err, context);
+        if (!M) {
+            std::string message;
+            raw_string_ostream os(message);
+            err.print("funcptr-bench", os);
+            return json::Object{{"file", file}, {"error", os.str()}};
+        }
+        legacy::PassManager passes;
+        passes.add(createPromoteMemoryToRegisterPass());
+        passes.run(*M);
+
+        FuncPtrAnalysis analysis;
+        FuncPtrAnalysis::Options options;
+        options.keepStates = false;
+        auto start = std::chrono::steady_clock::now();
+        analysis.run(*M, options);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        if (i == 0) {
+            for (Function &F : *M) {
+                if (F.isDeclaration()) continue;
+                functions++;
+                instructions += F.getInstructionCount();
+            }
+            for (const auto &line : analysis.getLineResults()) {
+                if (!line.second.empty()) callSites++;
+            }
+            blockVisits = analysis.getVisitor().blockVisits;
+            calleeAnalyses = analysis.getVisitor().calleeAnalyses;
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double t : times) sum += t;
+    return json::Object{
+        {"file", file},
+        {"functions", functions},
+        {"instructions", instructions},
+        {"resultLines", callSites},
+        {"runs", (int64_t)times.size()},
+        {"wallMs", json::Object{{"min", times.front()},
+                                {"median", times[times.size() / 2]},
+                                {"mean", sum / times.size()}}},
+        {"peakRssKB", peakRssKB()},
+        {"blockVisits", (int64_t)blockVisits},
+        {"calleeAnalyses", (int64_t)calleeAnalyses},
+    };
+}
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "funcptr end-to-end benchmark\n");
+
+    json::Array results;
+    for (const std::string &file : collectInputs()) {
+        results.push_back(benchmark(file));
+    }
+
+    std::error_code EC;
+    raw_fd_ostream out(Output, EC, sys::fs::OF_None);
+    if (EC) {
+        errs() << "funcptr-bench: " << Output << ": " << EC.message() << "\n";
+        return 1;
+    }
+    out << formatv("{0:2}", json::Value(json::Object{{"repeat", (int64_t)Repeat},
+                                                     {"inputs", std::move(results)}}))
+        << "\n";
+    return 0;
+}
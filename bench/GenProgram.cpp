@@ -0,0 +1,172 @@
+//===- GenProgram.cpp - synthetic C programs for scaling the analysis -----===//
+//
+// funcptr-gen [-functions N] [-depth D] [-fanout K] [-targets T] [-loops L]
+//             [-recursion] [-seed S] [-o out.c]
+//
+// 生成和 test22 ~ test34 同一类的 C 程序：malloc 出来的结构体里放函数指针，
+// make_alias / swap 辅助函数改写别名，pick 函数返回回调，多层调用一路把结构体指针往下传。
+//   -functions  分层函数的总数，平均分到 depth 层里
+//   -depth      调用链的层数
+//   -fanout     每个函数调用下一层的几个函数
+//   -targets    叶子运算函数（op0 ... op{T-1}）的个数，也就是间接调用可能的目标个数
+//   -loops      每个分层函数里间接调用外面套几层循环
+//   -recursion  最后一层回调第一层，形成递归（有计数器保证程序本身会终止）
+//   -seed       同样的参数和种子总是生成同样的程序
+// 入口是最后一个函数 entry，和测试用例一样由分析器当作入口。
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+using namespace llvm;
+
+static cl::opt<unsigned> Functions("functions", cl::desc("Number of layered functions"), cl::init(8));
+static cl::opt<unsigned> Depth("depth", cl::desc("Call depth (number of layers)"), cl::init(4));
+static cl::opt<unsigned> Fanout("fanout", cl::desc("Calls from each function into the next layer"), cl::init(2));
+static cl::opt<unsigned> Targets("targets", cl::desc("Number of possible indirect-call targets"), cl::init(4));
+static cl::opt<unsigned> Loops("loops", cl::desc("Loop nesting around indirect calls"), cl::init(1));
+static cl::opt<bool> Recursion("recursion", cl::desc("Let the last layer call back into the first"), cl::init(false));
+static cl::opt<unsigned> Seed("seed", cl::desc("Random seed"), cl::init(1));
+static cl::opt<std::string> Output("o", cl::desc("Output file"), cl::value_desc("file"), cl::init("-"));
+
+namespace {
+
+class Generator {
+public:
+    explicit Generator(raw_ostream &out) : out(out), rng(Seed) {
+        depth = std::max(1u, (unsigned)Depth);
+        width = std::max(1u, ((unsigned)Functions + depth - 1) / depth);
+        targets = std::max(2u, (unsigned)Targets);
+    }
+
+    void run() {
+        out << "#include <stdlib.h>\n"
+               "struct fptr\n{\n\tint (*p_fptr)(int, int);\n};\n"
+               "struct fsptr\n{\n\tstruct fptr * sptr;\n};\n\n";
+        emitTargets();
+        emitHelpers();
+        for (unsigned d = depth; d-- > 0;) {
+            for (unsigned i = 0; i < width; i++) emitDeclaration(d, i);
+        }
+        out << "\n";
+        for (unsigned d = depth; d-- > 0;) {
+            for (unsigned i = 0; i < width; i++) emitLayer(d, i);
+        }
+        emitEntry();
+    }
+
+private:
+    raw_ostream &out;
+    std::mt19937 rng;
+    unsigned depth, width, targets;
+
+    unsigned pick(unsigned n) { return std::uniform_int_distribution<unsigned>(0, n - 1)(rng); }
+
+    std::string layer(unsigned d, unsigned i) {
+        return "layer" + std::to_string(d) + "_" + std::to_string(i);
+    }
+
+    void emitTargets() {
+        static const char *ops[] = {"a+b", "a-b", "a*b", "a^b", "a|b", "a&b"};
+        for (unsigned t = 0; t < targets; t++) {
+            out << "int op" << t << "(int a, int b) {\n   return (" << ops[t % 6] << ") + " << t << ";\n}\n\n";
+        }
+    }
+
+    void emitHelpers() {
+        out << "void make_alias(struct fsptr *a, struct fsptr *b)\n{\n"
+               "\ta->sptr->p_fptr = b->sptr->p_fptr;\n}\n\n"
+               "void make_simple_alias(struct fsptr *a, struct fsptr *b)\n{\n"
+               "\ta->sptr = b->sptr;\n}\n\n"
+               "void swap(struct fptr *a, struct fptr *b)\n{\n"
+               "\tstruct fptr t = *a;\n\t*a = *b;\n\t*b = t;\n}\n\n"
+               "int (*pick(int x, int (*a)(int, int), int (*b)(int, int)))(int, int)\n{\n"
+               "\tint (*r)(int, int) = a;\n\tif (x > 0)\n\t\tr = b;\n\treturn r;\n}\n\n";
+    }
+
+    void emitDeclaration(unsigned d, unsigned i) {
+        out << "int " << layer(d, i) << "(int x, struct fsptr *s, struct fsptr *t, int n);\n";
+    }
+
+    /// 分层函数：循环里做间接调用，按 x 的值改写别名，再调用下一层的 fanout 个函数
+    void emitLayer(unsigned d, unsigned i) {
+        out << "int " << layer(d, i) << "(int x, struct fsptr *s, struct fsptr *t, int n)\n{\n";
+        std::string indent = "\t";
+        for (unsigned l = 0; l < Loops; l++) {
+            std::string var = "i" + std::to_string(l);
+            out << indent << "for (int " << var << " = 0; " << var << " < " << (2 + l) << "; " << var << "++) {\n";
+            indent += "\t";
+        }
+        out << indent << "x = s->sptr->p_fptr(x, n);\n";
+        switch (pick(4)) {
+        case 0:
+            out << indent << "if (x > " << pick(16) << ")\n" << indent << "\tmake_alias(s, t);\n";
+            break;
+        case 1:
+            out << indent << "if (x & 1)\n" << indent << "\tswap(s->sptr, t->sptr);\n";
+            break;
+        case 2:
+            out << indent << "s->sptr->p_fptr = pick(x, s->sptr->p_fptr, op" << pick(targets) << ");\n";
+            break;
+        default:
+            out << indent << "if (x < 0)\n" << indent << "\tmake_simple_alias(t, s);\n";
+            break;
+        }
+        for (unsigned l = 0; l < Loops; l++) {
+            indent.pop_back();
+            out << indent << "}\n";
+        }
+
+        if (d + 1 < depth) {
+            for (unsigned k = 0; k < std::min((unsigned)Fanout, width); k++) {
+                out << "\tx = " << layer(d + 1, (i + k) % width) << "(x, " << (k % 2 ? "t, s" : "s, t") << ", n);\n";
+            }
+        } else {
+            out << "\tx = t->sptr->p_fptr(x, n);\n";
+            if (Recursion) {
+                out << "\tif (n > 0)\n\t\tx = " << layer(0, i % width) << "(x, t, s, n - 1);\n";
+            }
+        }
+        out << "\treturn x;\n}\n\n";
+    }
+
+    void emitEntry() {
+        out << "int entry(int x)\n{\n"
+               "\tstruct fptr *a = (struct fptr *)malloc(sizeof(struct fptr));\n"
+               "\tstruct fptr *b = (struct fptr *)malloc(sizeof(struct fptr));\n"
+               "\tstruct fsptr *s = (struct fsptr *)malloc(sizeof(struct fsptr));\n"
+               "\tstruct fsptr *t = (struct fsptr *)malloc(sizeof(struct fsptr));\n"
+               "\ta->p_fptr = op0;\n"
+               "\tb->p_fptr = op1;\n"
+               "\ts->sptr = a;\n"
+               "\tt->sptr = b;\n";
+        for (unsigned t = 2; t < targets; t++) {
+            out << "\tif (x == " << t << ")\n\t\t" << (t % 2 ? "b" : "a") << "->p_fptr = op" << t << ";\n";
+        }
+        for (unsigned i = 0; i < width; i++) {
+            out << "\tx = " << layer(0, i) << "(x, s, t, " << (Recursion ? 2 : 0) << ");\n";
+        }
+        out << "\treturn x;\n}\n";
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "Synthetic C programs for the funcptr analysis\n");
+
+    std::error_code EC;
+    raw_fd_ostream out(Output, EC, sys::fs::OF_Text);
+    if (EC) {
+        errs() << "funcptr-gen: " << Output << ": " << EC.message() << "\n";
+        return 1;
+    }
+    Generator(out).run();
+    return 0;
+}
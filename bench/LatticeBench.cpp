@@ -0,0 +1,164 @@
+//===- LatticeBench.cpp - microbenchmarks of the dataflow lattice ---------===//
+//
+// funcptr-microbench [--benchmark_filter=...]
+//
+// 每次求不动点最内层的几个操作：PointToInfo 的拷贝、PointToVisitor::merge、operator==，
+// 以及 LivenessVisitor::merge。参数是 (key 个数, 每个 key 的集合大小)：
+//   16 x 4      测试用例里常见的大小
+//   256 x 16    生成的大程序
+//   4096 x 64   极端情况
+// 状态里的值都是同一个函数里的 alloca，和真实分析一样是 LLVM Value 指针。
+//
+//===----------------------------------------------------------------------===//
+
+#include "PointTo.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+/// 一个有 n 个 alloca 的函数，提供状态里用到的 Value
+class ValuePool {
+public:
+    explicit ValuePool(unsigned n) : module("lattice-bench", context) {
+        Function *fn = Function::Create(FunctionType::get(Type::getVoidTy(context), false),
+                                        Function::ExternalLinkage, "f", &module);
+        IRBuilder<> builder(BasicBlock::Create(context, "entry", fn));
+        for (unsigned i = 0; i < n; i++) {
+            values.push_back(builder.CreateAlloca(Type::getInt8PtrTy(context)));
+        }
+        builder.CreateRetVoid();
+    }
+
+    Instruction *get(unsigned i) { return values[i % values.size()]; }
+
+private:
+    LLVMContext context;
+    Module module;
+    std::vector<Instruction *> values;
+};
+
+ValuePool &pool() {
+    static ValuePool values(4096 * 2 + 64);
+    return values;
+}
+
+/// keys 个 key，每个 key 的 pointToSets 和 bindings 各有 width 个值；shift 让两个状态部分重叠
+PointToInfo makePointTo(unsigned keys, unsigned width, unsigned shift) {
+    PointToInfo info;
+    for (unsigned k = 0; k < keys; k++) {
+        std::set<Value *> targets, bound;
+        for (unsigned j = 0; j < width; j++) {
+            targets.insert(pool().get(keys + k * 7 + j + shift));
+            bound.insert(pool().get(k + j * 3 + shift));
+        }
+        info.setPointToSet(pool().get(k), targets, 0);
+        info.setBinding(pool().get(keys + k), bound, 0);
+    }
+    return info;
+}
+
+LivenessInfo makeLiveness(unsigned size, unsigned shift) {
+    LivenessInfo info;
+    for (unsigned i = 0; i < size; i++) info.insert(pool().get(i + shift));
+    return info;
+}
+
+void latticeSizes(benchmark::internal::Benchmark *b) {
+    b->Args({16, 4})->Args({256, 16})->Args({4096, 64});
+}
+
+void BM_PointToInfoCopy(benchmark::State &state) {
+    PointToInfo info = makePointTo(state.range(0), state.range(1), 0);
+    for (auto _ : state) {
+        PointToInfo copy(info);
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_PointToInfoCopy)->Apply(latticeSizes);
+
+/// 不动点附近最常见的情况：src 已经包含在 dest 里，merge 不改变 dest
+void BM_PointToMergeNoChange(benchmark::State &state) {
+    PointToVisitor visitor;
+    PointToInfo src = makePointTo(state.range(0), state.range(1), 0);
+    PointToInfo dest = src;
+    for (auto _ : state) {
+        visitor.merge(&dest, src);
+        benchmark::DoNotOptimize(dest);
+    }
+}
+BENCHMARK(BM_PointToMergeNoChange)->Apply(latticeSizes);
+
+/// 两个部分重叠的状态合并，每次都从原始的 dest 开始（拷贝不计时）
+void BM_PointToMergeGrow(benchmark::State &state) {
+    PointToVisitor visitor;
+    PointToInfo original = makePointTo(state.range(0), state.range(1), 0);
+    PointToInfo src = makePointTo(state.range(0), state.range(1), 1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        PointToInfo dest = original;
+        state.ResumeTiming();
+        visitor.merge(&dest, src);
+        benchmark::DoNotOptimize(dest);
+    }
+}
+BENCHMARK(BM_PointToMergeGrow)->Apply(latticeSizes);
+
+/// 相等的状态：指纹相同，要做完整比较
+void BM_PointToEqualSame(benchmark::State &state) {
+    PointToInfo a = makePointTo(state.range(0), state.range(1), 0);
+    PointToInfo b = a;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(BM_PointToEqualSame)->Apply(latticeSizes);
+
+/// 不相等的状态：指纹不同，直接返回
+void BM_PointToEqualDiffer(benchmark::State &state) {
+    PointToInfo a = makePointTo(state.range(0), state.range(1), 0);
+    PointToInfo b = makePointTo(state.range(0), state.range(1), 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(BM_PointToEqualDiffer)->Apply(latticeSizes);
+
+/// LivenessInfo 只有一个集合，大小取 key 个数 x 集合大小
+void BM_LivenessMergeNoChange(benchmark::State &state) {
+    LivenessVisitor visitor;
+    LivenessInfo src = makeLiveness(state.range(0) * state.range(1) / 8 + 1, 0);
+    LivenessInfo dest = src;
+    for (auto _ : state) {
+        visitor.merge(&dest, src);
+        benchmark::DoNotOptimize(dest);
+    }
+}
+BENCHMARK(BM_LivenessMergeNoChange)->Apply(latticeSizes);
+
+void BM_LivenessMergeGrow(benchmark::State &state) {
+    LivenessVisitor visitor;
+    unsigned size = state.range(0) * state.range(1) / 8 + 1;
+    LivenessInfo original = makeLiveness(size, 0);
+    LivenessInfo src = makeLiveness(size, size / 2);
+    for (auto _ : state) {
+        state.PauseTiming();
+        LivenessInfo dest = original;
+        state.ResumeTiming();
+        visitor.merge(&dest, src);
+        benchmark::DoNotOptimize(dest);
+    }
+}
+BENCHMARK(BM_LivenessMergeGrow)->Apply(latticeSizes);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,259 @@
+//===- FuncPtrApiTest.cpp - checks of the FuncPtrAnalysis query API -------===//
+//
+// funcptr-api-test [-expect-...] <file.bc>
+//
+// 用 funcptr 库分析一个模块，然后在每条指令前调用 getPointsTo / getAliases，检查：
+//   - 查询不改变分析结果：查询前后 getLineResults 和每个调用点的 getCallees 完全一样，
+//     分析自己的 visitor 上没有新的工作量，同样的查询重复一遍答案不变；
+//   - 每个被分析走到的调用点，getCallees 和这一行的 getLineResults 一致；
+//   - 命令行上给出的已知答案（-expect-points-to、-expect-aliases、-expect-exact、-expect-approximated），
+//     都是针对某一行上的调用点，名字按 getName() 比较，必须完全相同。
+// 最后按命令行工具的格式打印结果，再打印一行 "ok" 和查询次数；有不一致时打印出来并返回 1。
+//
+//===----------------------------------------------------------------------===//
+
+#include "FuncPtrAnalysis.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils.h"
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+Input(cl::Positional, cl::desc("<filename>.bc"), cl::Required);
+
+static cl::list<std::string>
+ExpectPointsTo("expect-points-to",
+               cl::desc("LINE:VALUE:NAMES - before the call on LINE, getPointsTo of VALUE (named in the caller) is exactly NAMES"),
+               cl::value_desc("line:value:a,b"));
+
+static cl::list<std::string>
+ExpectAliases("expect-aliases",
+              cl::desc("LINE:NAMES - before the call on LINE, getAliases of the called operand is exactly NAMES"),
+              cl::value_desc("line:a,b"));
+
+static cl::list<unsigned>
+ExpectExact("expect-exact", cl::desc("isApproximated is false for the call on LINE"), cl::value_desc("line"));
+
+static cl::list<unsigned>
+ExpectApproximated("expect-approximated", cl::desc("isApproximated is true for the call on LINE"),
+                   cl::value_desc("line"));
+
+static cl::opt<unsigned>
+MaxPointsTo("max-points-to", cl::desc("FuncPtrAnalysis::Options::maxPointsTo"), cl::init(64));
+
+typedef std::map<const CallBase *, std::vector<const Function *>> CalleeMap;
+
+static CalleeMap collectCallees(Module &M, const FuncPtrAnalysis &analysis) {
+    CalleeMap callees;
+    for (Function &F : M) {
+        for (BasicBlock &BB : F) {
+            for (Instruction &I : BB) {
+                if (const CallBase *call = dyn_cast<CallBase>(&I)) {
+                    callees[call] = analysis.getCallees(call);
+                }
+            }
+        }
+    }
+    return callees;
+}
+
+/// 行号为 line 的第一个调用（不算调试 intrinsic），没有时为空
+static CallBase *callAtLine(Module &M, unsigned line) {
+    for (Function &F : M) {
+        for (BasicBlock &BB : F) {
+            for (Instruction &I : BB) {
+                CallBase *call = dyn_cast<CallBase>(&I);
+                if (call && !isa<DbgInfoIntrinsic>(call) && call->getDebugLoc()
+                    && call->getDebugLoc().getLine() == line) {
+                    return call;
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+static Value *findValue(Function *fn, StringRef name) {
+    for (Argument &arg : fn->args()) {
+        if (arg.getName() == name) return &arg;
+    }
+    for (BasicBlock &bb : *fn) {
+        for (Instruction &inst : bb) {
+            if (inst.getName() == name) return &inst;
+        }
+    }
+    return fn->getParent()->getNamedValue(name);
+}
+
+static std::set<std::string> namesOf(const std::set<const Value *> &values) {
+    std::set<std::string> names;
+    for (const Value *val : values) names.insert(val->getName().str());
+    return names;
+}
+
+static std::set<std::string> parseNames(StringRef list) {
+    SmallVector<StringRef, 4> parts;
+    list.split(parts, ',', -1, false);
+    std::set<std::string> names;
+    for (StringRef part : parts) names.insert(part.trim().str());
+    return names;
+}
+
+static std::string join(const std::set<std::string> &names) {
+    std::string text;
+    for (const std::string &name : names) text += (text.empty() ? "" : ", ") + name;
+    return "{" + text + "}";
+}
+
+/// 命令行上的已知答案，返回不符合的个数
+static unsigned checkExpectations(Module &M, FuncPtrAnalysis &analysis) {
+    unsigned failures = 0;
+    auto lookup = [&](StringRef spec, StringRef lineText) -> CallBase * {
+        unsigned line;
+        CallBase *call = lineText.getAsInteger(10, line) ? nullptr : callAtLine(M, line);
+        if (!call) {
+            outs() << "no call at line " << lineText << " for " << spec << "\n";
+            failures++;
+        }
+        return call;
+    };
+    auto compare = [&](const std::string &what, const std::set<std::string> &got,
+                       const std::set<std::string> &expected) {
+        if (got != expected) {
+            outs() << what << ": got " << join(got) << ", expected " << join(expected) << "\n";
+            failures++;
+        }
+    };
+
+    for (StringRef spec : ExpectPointsTo) {
+        StringRef lineText, rest, valueName, names;
+        std::tie(lineText, rest) = spec.split(':');
+        std::tie(valueName, names) = rest.split(':');
+        CallBase *call = lookup(spec, lineText);
+        if (!call) continue;
+        Value *val = findValue(call->getFunction(), valueName);
+        if (!val) {
+            outs() << "no value " << valueName << " in " << call->getFunction()->getName() << "\n";
+            failures++;
+            continue;
+        }
+        compare("getPointsTo(" + valueName.str() + ") before line " + lineText.str(),
+                namesOf(analysis.getPointsTo(val, call)), parseNames(names));
+    }
+    for (StringRef spec : ExpectAliases) {
+        StringRef lineText, names;
+        std::tie(lineText, names) = spec.split(':');
+        CallBase *call = lookup(spec, lineText);
+        if (!call) continue;
+        compare("getAliases(called operand) before line " + lineText.str(),
+                namesOf(analysis.getAliases(call->getCalledOperand(), call)), parseNames(names));
+    }
+    for (unsigned line : ExpectExact) {
+        CallBase *call = lookup("-expect-exact", std::to_string(line));
+        if (call && analysis.isApproximated(call)) {
+            outs() << "isApproximated at line " << line << " is true, expected false\n";
+            failures++;
+        }
+    }
+    for (unsigned line : ExpectApproximated) {
+        CallBase *call = lookup("-expect-approximated", std::to_string(line));
+        if (call && !analysis.isApproximated(call)) {
+            outs() << "isApproximated at line " << line << " is false, expected true\n";
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "FuncPtrAnalysis query API checks\n");
+
+    LLVMContext context;
+    SMDiagnostic err;
+    std::unique_ptr<Module> M = parseIRFile(Input, err, context);
+    if (!M) {
+        err.print(argv[0], errs());
+        return 1;
+    }
+    legacy::PassManager passes;
+    passes.add(createPromoteMemoryToRegisterPass());
+    passes.run(*M);
+
+    FuncPtrAnalysis analysis;
+    FuncPtrAnalysis::Options options;
+    options.maxPointsTo = MaxPointsTo;
+    analysis.run(*M, options);
+    const std::map<unsigned, std::set<std::string>> lineResults = analysis.getLineResults();
+    const CalleeMap callees = collectCallees(*M, analysis);
+
+    unsigned failures = 0;
+    for (const auto &site : callees) {
+        if (site.second.empty()) continue;
+        std::set<std::string> names;
+        for (const Function *callee : site.second) names.insert(callee->getName().str());
+        unsigned line = site.first->getDebugLoc() ? site.first->getDebugLoc().getLine() : 0;
+        auto it = lineResults.find(line);
+        if (it == lineResults.end() || !std::includes(it->second.begin(), it->second.end(),
+                                                      names.begin(), names.end())) {
+            outs() << "getCallees at line " << line << " disagrees with getLineResults\n";
+            failures++;
+        }
+    }
+
+    // 在每条指令前查询每个指针类型的操作数，查两遍，两遍的答案应该一样
+    typedef std::pair<std::set<const Value *>, std::set<const Value *>> Answer;
+    std::vector<Answer> answers[2];
+    uint64_t blockVisits = analysis.getVisitor().blockVisits;
+    for (auto &round : answers) {
+        for (Function &F : *M) {
+            for (BasicBlock &BB : F) {
+                for (Instruction &I : BB) {
+                    for (Value *operand : I.operands()) {
+                        if (!operand->getType()->isPointerTy()) continue;
+                        round.emplace_back(analysis.getPointsTo(operand, &I), analysis.getAliases(operand, &I));
+                    }
+                }
+            }
+        }
+    }
+    size_t queries = answers[0].size();
+
+    if (answers[0] != answers[1]) {
+        outs() << "repeating the queries gave different answers\n";
+        failures++;
+    }
+    if (analysis.getVisitor().blockVisits != blockVisits) {
+        outs() << "queries re-ran the analysis on its own visitor\n";
+        failures++;
+    }
+    if (analysis.getLineResults() != lineResults) {
+        outs() << "getLineResults changed after queries\n";
+        failures++;
+    }
+    if (collectCallees(*M, analysis) != callees) {
+        outs() << "getCallees changed after queries\n";
+        failures++;
+    }
+
+    failures += checkExpectations(*M, analysis);
+
+    analysis.printResults(outs());
+    if (failures) {
+        return 1;
+    }
+    outs() << "ok, " << queries << " queries\n";
+    return 0;
+}
@@ -0,0 +1,30 @@
+struct S {
+    int (*p)(int, int);
+};
+
+int plus(int a, int b) {
+   return a+b;
+}
+
+int minus(int a, int b) {
+   return a-b;
+}
+
+void set(struct S *s) {
+    s->p = minus;
+}
+
+int f(struct S *s) {
+    set(s);
+    return s->p(1, 2);
+}
+
+int moo() {
+    struct S s;
+    s.p = plus;
+    return f(&s);
+}
+
+/// 18 : set
+/// 19 : minus
+/// 25 : f
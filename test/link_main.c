@@ -0,0 +1,34 @@
+#include <stdlib.h>
+
+int plus(int a, int b);
+
+
+
+int minus(int a,int b);
+
+
+
+
+int foo(int a,int b,int(* a_fptr)(int, int))
+{
+    return a_fptr(a,b);
+}
+
+
+int moo(char x)
+{
+    int (*af_ptr)(int ,int ,int(*)(int, int))=foo;
+    int (*pf_ptr)(int,int)=0;
+    if(x == '+'){
+        pf_ptr=plus;
+        af_ptr(1,2,pf_ptr);
+        pf_ptr=minus;
+    }
+    af_ptr(1,2,pf_ptr);
+    return 0;
+}
+
+// 分开分析：plus、minus 定义在 link_ops.c 里，行号和 test00.c 一致
+//14 : plus, minus
+//24 : foo
+//27 : foo
@@ -0,0 +1,10 @@
+#include <stdlib.h>
+
+int plus(int a, int b) {
+   return a+b;
+}
+
+int minus(int a,int b)
+{
+    return a-b;
+}
@@ -0,0 +1,17 @@
+int plus(int a, int b) {
+   return a+b;
+}
+
+int minus(int a, int b) {
+   return a-b;
+}
+
+// 分析不处理全局变量的初始值，只看得到 main 里存进去的 minus
+int (*g)(int, int) = plus;
+
+int main(int argc, char **argv) {
+   int x = argc - 1;
+   if (x > 0)
+      g = minus;
+   return g(5, 3);
+}
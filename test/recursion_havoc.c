@@ -0,0 +1,31 @@
+struct S {
+    int (*p)(int, int);
+};
+
+int plus(int a, int b) {
+   return a+b;
+}
+
+int minus(int a, int b) {
+   return a-b;
+}
+
+void pick(struct S *a, struct S *b, int n) {
+    if (n > 0) {
+        pick(b, a, n - 1);
+        return;
+    }
+    a->p = minus;
+}
+
+int moo(int n) {
+    struct S x, y;
+    x.p = plus;
+    y.p = plus;
+    pick(&x, &y, n);
+    return y.p(1, 2);
+}
+
+/// 15 : pick
+/// 25 : pick
+/// 26 : plus, minus